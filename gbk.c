@@ -0,0 +1,342 @@
+#include "http.h"
+#include "gbk_table.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// ==================== UTF-8 / GBK 转换 ====================
+// 基于查表的转换，不依赖系统代码页，也不依赖 Win32，可以单独编译到其他平台。
+// 连续的 ASCII 字节按块整体复制，无法映射或非法的字符输出 '?'，
+// 与 WideCharToMultiByte 的默认行为一致。和 CP936 一样，单字节 0x80 与 U+20AC（€）互相转换。
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GBK_HAVE_SSE2 1
+#endif
+
+// 返回从 src 开始连续 ASCII 字节的长度
+static size_t ascii_run_length(const unsigned char* src, size_t len) {
+	size_t i = 0;
+#ifdef GBK_HAVE_SSE2
+	while (i + 16 <= len) {
+		int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(src + i)));
+		if (mask != 0) {
+			while ((mask & 1) == 0) {
+				mask >>= 1;
+				i++;
+			}
+			return i;
+		}
+		i += 16;
+	}
+#else
+	while (i + 8 <= len) {
+		unsigned long long word;
+		memcpy(&word, src + i, 8);
+		if (word & 0x8080808080808080ULL) break;
+		i += 8;
+	}
+#endif
+	while (i < len && src[i] < 0x80) i++;
+	return i;
+}
+
+// Unicode 码点转 GBK 编码，无法映射返回 0；小于 0x100 的结果是单字节编码（0x80 = €）
+static unsigned short unicode_to_gbk(unsigned int cp) {
+	if (cp > 0xFFFF) return 0;
+	unsigned char page = unicode_to_gbk_index[cp >> 8];
+	return page ? unicode_to_gbk_pages[page][cp & 0xFF] : 0;
+}
+
+// 初始化流式转换器
+void gbk_converter_init(GbkConverter* conv) {
+	if (conv == NULL) return;
+	conv->pending_len = 0;
+}
+
+// 解码一个 UTF-8 多字节序列。返回序列长度；输入不完整返回 0；非法返回 -1（*cp 不变）
+static int utf8_decode(const unsigned char* s, size_t len, unsigned int* cp) {
+	unsigned char c = s[0];
+	int need;
+	unsigned int value;
+	unsigned int min;
+
+	if (c >= 0xC2 && c <= 0xDF) { need = 2; value = c & 0x1F; min = 0x80; }
+	else if (c >= 0xE0 && c <= 0xEF) { need = 3; value = c & 0x0F; min = 0x800; }
+	else if (c >= 0xF0 && c <= 0xF4) { need = 4; value = c & 0x07; min = 0x10000; }
+	else return -1;
+
+	for (int i = 1; i < need; i++) {
+		if ((size_t)i >= len) return 0;
+		if ((s[i] & 0xC0) != 0x80) return -1;
+		value = (value << 6) | (s[i] & 0x3F);
+	}
+	if (value < min || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF)) return -1;
+
+	*cp = value;
+	return need;
+}
+
+// 流式 UTF-8 转 GBK。src 末尾不完整的字符保存在 conv 中，随下一块一起转换；
+// src 为 NULL 表示输入结束，此时残留字节输出为 '?'。
+// 返回写入 dst 的字节数；dst_size 不小于 src_len + 1 时总能消耗全部输入，
+// 否则 *src_used 返回实际消耗的输入字节数（可为 NULL）
+size_t utf8_to_gbk_chunk(GbkConverter* conv, const char* src, size_t src_len,
+	char* dst, size_t dst_size, size_t* src_used) {
+	const unsigned char* in = (const unsigned char*)src;
+	unsigned char* out = (unsigned char*)dst;
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+
+	if (src == NULL) {
+		// 输入结束：残留的不完整序列视为非法字符
+		if (conv->pending_len > 0 && dst_size > 0) {
+			out[out_pos++] = '?';
+			conv->pending_len = 0;
+		}
+		if (src_used) *src_used = 0;
+		return out_pos;
+	}
+
+	// 先拼接上一块遗留的字节
+	while (conv->pending_len > 0 && in_pos < src_len && out_pos < dst_size) {
+		unsigned int cp = 0;
+		conv->pending[conv->pending_len++] = in[in_pos++];
+		int n = utf8_decode(conv->pending, conv->pending_len, &cp);
+		if (n == 0) continue;
+
+		unsigned short gbk = n > 0 ? unicode_to_gbk(cp) : 0;
+		if (gbk) {
+			if (out_pos + (gbk > 0xFF ? 2 : 1) > dst_size) {
+				// 空间不足，退回这个字节，下次调用重新拼接
+				conv->pending_len--;
+				in_pos--;
+				break;
+			}
+			if (gbk > 0xFF) out[out_pos++] = (unsigned char)(gbk >> 8);
+			out[out_pos++] = (unsigned char)gbk;
+		}
+		else {
+			out[out_pos++] = '?';
+			// 导致失败的字节重新按普通输入处理
+			if (n < 0 && conv->pending_len > 1) in_pos--;
+		}
+		conv->pending_len = 0;
+	}
+
+	while (in_pos < src_len && conv->pending_len == 0) {
+		if (in[in_pos] < 0x80) {
+			size_t run = ascii_run_length(in + in_pos, src_len - in_pos);
+			if (run > dst_size - out_pos) run = dst_size - out_pos;
+			if (run == 0) break;
+			memcpy(out + out_pos, in + in_pos, run);
+			in_pos += run;
+			out_pos += run;
+			continue;
+		}
+
+		if (out_pos >= dst_size) break;
+
+		unsigned int cp = 0;
+		int n = utf8_decode(in + in_pos, src_len - in_pos, &cp);
+		if (n == 0) {
+			// 字符跨越块边界，保存到下一块
+			conv->pending_len = (int)(src_len - in_pos);
+			memcpy(conv->pending, in + in_pos, conv->pending_len);
+			in_pos = src_len;
+			break;
+		}
+		if (n < 0) {
+			out[out_pos++] = '?';
+			in_pos++;
+			continue;
+		}
+
+		unsigned short gbk = unicode_to_gbk(cp);
+		if (gbk) {
+			if (out_pos + (gbk > 0xFF ? 2 : 1) > dst_size) break;
+			if (gbk > 0xFF) out[out_pos++] = (unsigned char)(gbk >> 8);
+			out[out_pos++] = (unsigned char)gbk;
+		}
+		else {
+			out[out_pos++] = '?';
+		}
+		in_pos += n;
+	}
+
+	if (src_used) *src_used = in_pos;
+	return out_pos;
+}
+
+// 流式 GBK 转 UTF-8，参数与 utf8_to_gbk_chunk 相同；
+// dst_size 不小于 src_len * 3 时总能消耗全部输入（单字节 0x80 会展开成 3 字节的 €）
+size_t gbk_to_utf8_chunk(GbkConverter* conv, const char* src, size_t src_len,
+	char* dst, size_t dst_size, size_t* src_used) {
+	const unsigned char* in = (const unsigned char*)src;
+	unsigned char* out = (unsigned char*)dst;
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+
+	if (src == NULL) {
+		if (conv->pending_len > 0 && dst_size > 0) {
+			out[out_pos++] = '?';
+			conv->pending_len = 0;
+		}
+		if (src_used) *src_used = 0;
+		return out_pos;
+	}
+
+	while (in_pos < src_len) {
+		if (conv->pending_len == 0 && in[in_pos] < 0x80) {
+			size_t run = ascii_run_length(in + in_pos, src_len - in_pos);
+			if (run > dst_size - out_pos) run = dst_size - out_pos;
+			if (run == 0) break;
+			memcpy(out + out_pos, in + in_pos, run);
+			in_pos += run;
+			out_pos += run;
+			continue;
+		}
+
+		// 挂起的首字节已在上一块消耗，本块从尾字节开始
+		unsigned char lead = conv->pending_len > 0 ? conv->pending[0] : in[in_pos];
+		size_t trail_pos = conv->pending_len > 0 ? in_pos : in_pos + 1;
+		size_t used = trail_pos - in_pos;
+		unsigned int cp = 0;
+
+		if (conv->pending_len == 0 && lead == 0x80) {
+			// CP936 的单字节欧元符号
+			cp = 0x20AC;
+		}
+		else if (conv->pending_len == 0 && lead == 0xFF) {
+			// 非法首字节，输出 '?'
+		}
+		else if (trail_pos >= src_len) {
+			// 首字节在块末尾，等待下一块
+			conv->pending[0] = lead;
+			conv->pending_len = 1;
+			in_pos++;
+			break;
+		}
+		else {
+			unsigned char trail = in[trail_pos];
+			if (trail >= 0x40 && trail <= 0xFE && trail != 0x7F) {
+				cp = gbk_to_unicode_table[lead - 0x81][trail - 0x40];
+				used++;
+			}
+			// 非法尾字节不消耗，留给下一轮按普通字节处理
+		}
+
+		size_t need = cp == 0 ? 1 : (cp < 0x800 ? 2 : 3);
+		if (out_pos + need > dst_size) break;
+		in_pos += used;
+		conv->pending_len = 0;
+
+		if (cp == 0) {
+			out[out_pos++] = '?';
+		}
+		else if (cp < 0x800) {
+			out[out_pos++] = (unsigned char)(0xC0 | (cp >> 6));
+			out[out_pos++] = (unsigned char)(0x80 | (cp & 0x3F));
+		}
+		else {
+			out[out_pos++] = (unsigned char)(0xE0 | (cp >> 12));
+			out[out_pos++] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+			out[out_pos++] = (unsigned char)(0x80 | (cp & 0x3F));
+		}
+	}
+
+	if (src_used) *src_used = in_pos;
+	return out_pos;
+}
+
+// UTF-8 转 GBK，结果写入 dst 并以 '\0' 结尾。返回写入的字节数（不含 '\0'），
+// dst 空间不足返回 -1。dst_size 为 src_len + 1 时一定足够
+int utf8_to_gbk_buf(const char* src, size_t src_len, char* dst, size_t dst_size) {
+	if (src == NULL || dst == NULL || dst_size == 0) return -1;
+
+	GbkConverter conv;
+	size_t used = 0;
+	gbk_converter_init(&conv);
+	size_t n = utf8_to_gbk_chunk(&conv, src, src_len, dst, dst_size - 1, &used);
+	if (used < src_len) return -1;
+	n += utf8_to_gbk_chunk(&conv, NULL, 0, dst + n, dst_size - 1 - n, NULL);
+	dst[n] = '\0';
+	return (int)n;
+}
+
+// GBK 转 UTF-8，结果写入 dst 并以 '\0' 结尾。返回写入的字节数（不含 '\0'），
+// dst 空间不足返回 -1。dst_size 为 src_len * 3 + 1 时一定足够
+int gbk_to_utf8_buf(const char* src, size_t src_len, char* dst, size_t dst_size) {
+	if (src == NULL || dst == NULL || dst_size == 0) return -1;
+
+	GbkConverter conv;
+	size_t used = 0;
+	gbk_converter_init(&conv);
+	size_t n = gbk_to_utf8_chunk(&conv, src, src_len, dst, dst_size - 1, &used);
+	if (used < src_len) return -1;
+	n += gbk_to_utf8_chunk(&conv, NULL, 0, dst + n, dst_size - 1 - n, NULL);
+	dst[n] = '\0';
+	return (int)n;
+}
+
+// UTF-8 转 GBK 转换函数（返回的字符串需要 free）
+char* utf8_to_gbk(const char* utf8_str) {
+	if (utf8_str == NULL || strlen(utf8_str) == 0) {
+		return NULL;
+	}
+
+	// GBK 结果不会比 UTF-8 输入更长
+	size_t len = strlen(utf8_str);
+	char* gbk_str = (char*)malloc(len + 1);
+	if (gbk_str == NULL) {
+		return NULL;
+	}
+
+	if (utf8_to_gbk_buf(utf8_str, len, gbk_str, len + 1) < 0) {
+		free(gbk_str);
+		return NULL;
+	}
+	return gbk_str;
+}
+
+// GBK 转 UTF-8 转换函数（返回的字符串需要 free）
+char* gbk_to_utf8(const char* gbk_str) {
+	if (gbk_str == NULL || strlen(gbk_str) == 0) {
+		return NULL;
+	}
+
+	size_t len = strlen(gbk_str);
+	size_t size = len * 3 + 1;
+	char* utf8_str = (char*)malloc(size);
+	if (utf8_str == NULL) {
+		return NULL;
+	}
+
+	if (gbk_to_utf8_buf(gbk_str, len, utf8_str, size) < 0) {
+		free(utf8_str);
+		return NULL;
+	}
+	return utf8_str;
+}
+
+// 直接打印 UTF-8 字符串为 GBK（分块转换，不分配内存）
+void print_utf8_as_gbk(const char* utf8_str) {
+	if (utf8_str == NULL) {
+		return;
+	}
+
+	GbkConverter conv;
+	char out[1024];
+	size_t len = strlen(utf8_str);
+	size_t pos = 0;
+
+	gbk_converter_init(&conv);
+	while (pos < len) {
+		size_t used = 0;
+		size_t n = utf8_to_gbk_chunk(&conv, utf8_str + pos, len - pos, out, sizeof(out), &used);
+		fwrite(out, 1, n, stdout);
+		pos += used;
+	}
+	size_t n = utf8_to_gbk_chunk(&conv, NULL, 0, out, sizeof(out), NULL);
+	fwrite(out, 1, n, stdout);
+}
@@ -1,4 +1,5 @@
 #include "http.h"
+#include "hpack_table.h"
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <stdio.h>
@@ -6,6 +7,8 @@
 #include <windows.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <limits.h>
+#include <process.h>
 
 #pragma comment(lib, "ws2_32.lib")
 
@@ -20,6 +23,29 @@ void clear_json_object(JsonObject* obj) {
 	memset(obj->values, 0, sizeof(obj->values));
 }
 
+// 释放对象中嵌套的对象和数组（不释放 obj 本身）
+static void release_json_children(JsonObject* obj) {
+	if (obj == NULL) return;
+
+	for (int i = 0; i < obj->count; i++) {
+		if (obj->values[i].type == JSON_OBJECT && obj->values[i].object_value != NULL) {
+			release_json_children(obj->values[i].object_value);
+			free(obj->values[i].object_value);
+		}
+		else if (obj->values[i].type == JSON_ARRAY && obj->values[i].array_value != NULL) {
+			JsonArray* array = obj->values[i].array_value;
+			for (int j = 0; j < array->count; j++) {
+				if (array->element_types[j] == JSON_OBJECT && array->object_values[j] != NULL) {
+					release_json_children(array->object_values[j]);
+					free(array->object_values[j]);
+				}
+			}
+			free(array);
+		}
+	}
+	clear_json_object(obj);
+}
+
 // 跳过空白字符（增加安全检查）
 const char* skip_whitespace(const char* str) {
 	if (str == NULL) return NULL;
@@ -41,25 +67,117 @@ static void safe_strcpy(char* dest, size_t dest_size, const char* src, size_t sr
 	dest[src_len] = '\0';
 }
 
+// ==================== 解析内存分配 ====================
+// 默认使用 malloc；线程设置了 arena 时，解析产生的嵌套对象和数组从 arena 分配，
+// 由 arena 统一回收（NDJSON 并行解析使用）。
+
+#define JSON_ARENA_BLOCK_SIZE (1024 * 1024)
+
+typedef struct JsonArenaBlock {
+	struct JsonArenaBlock* next;
+	size_t size;
+	size_t used;
+	char* data;
+} JsonArenaBlock;
+
+typedef struct JsonArena {
+	JsonArenaBlock* head;
+	JsonArenaBlock* current;
+} JsonArena;
+
+static __declspec(thread) JsonArena* g_json_arena;
+
+static void* json_arena_alloc(JsonArena* arena, size_t size) {
+	size = (size + 15) & ~(size_t)15;
+
+	JsonArenaBlock* block = arena->current;
+	while (block != NULL && block->used + size > block->size) {
+		block = block->next;
+		if (block != NULL) block->used = 0;
+	}
+
+	if (block == NULL) {
+		size_t block_size = size > JSON_ARENA_BLOCK_SIZE ? size : JSON_ARENA_BLOCK_SIZE;
+		block = (JsonArenaBlock*)malloc(sizeof(JsonArenaBlock) + block_size);
+		if (block == NULL) return NULL;
+		block->size = block_size;
+		block->used = 0;
+		block->data = (char*)(block + 1);
+		block->next = NULL;
+		if (arena->current != NULL) {
+			// 接在当前块之后，保留后面已有的块
+			block->next = arena->current->next;
+			arena->current->next = block;
+		}
+		else {
+			arena->head = block;
+		}
+	}
+
+	arena->current = block;
+	void* p = block->data + block->used;
+	block->used += size;
+	return p;
+}
+
+// 回收 arena 中的全部分配，保留内存块以便复用
+static void json_arena_reset(JsonArena* arena) {
+	arena->current = arena->head;
+	if (arena->head != NULL) arena->head->used = 0;
+}
+
+static void json_arena_destroy(JsonArena* arena) {
+	JsonArenaBlock* block = arena->head;
+	while (block != NULL) {
+		JsonArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+	arena->head = arena->current = NULL;
+}
+
+static void* json_alloc(size_t size) {
+	return g_json_arena ? json_arena_alloc(g_json_arena, size) : malloc(size);
+}
+
+static void json_free(void* p) {
+	if (g_json_arena == NULL) free(p);
+}
+
+// 跳过空白字符，不超过 end
+static const char* skip_whitespace_n(const char* ptr, const char* end) {
+	if (ptr == NULL) return NULL;
+
+	while (ptr < end && isspace((unsigned char)*ptr)) {
+		ptr++;
+	}
+	return ptr;
+}
+
+// 检查 ptr 处是否为指定的字面量（true / false / null）
+static int match_literal(const char* ptr, const char* end, const char* literal, size_t len) {
+	return (size_t)(end - ptr) >= len && memcmp(ptr, literal, len) == 0;
+}
+
 // 解析 JSON 值（主要函数）
-static const char* parse_json_value(const char* ptr, JsonValue* value);
+static const char* parse_json_value(const char* ptr, const char* end, JsonValue* value);
 // 前向声明
-static const char* parse_json_array(const char* ptr, JsonArray* array);
+static const char* parse_json_array(const char* ptr, const char* end, JsonArray* array);
 JsonArray* create_json_array();
 void print_json_array(const JsonArray* array, int indent);
 
 // 解析嵌套对象
-static const char* parse_json_object(const char* ptr, JsonObject* obj) {
-	if (ptr == NULL || obj == NULL || *ptr != '{') {
+static const char* parse_json_object(const char* ptr, const char* end, JsonObject* obj) {
+	if (ptr == NULL || obj == NULL || ptr >= end || *ptr != '{') {
 		return NULL;
 	}
 
 	clear_json_object(obj);
 	ptr++; // 跳过 '{'
 
-	while (*ptr && obj->count < MAX_JSON_PAIRS) {
-		ptr = skip_whitespace(ptr);
-		if (ptr == NULL || *ptr == '\0') return NULL;
+	while (ptr < end && obj->count < MAX_JSON_PAIRS) {
+		ptr = skip_whitespace_n(ptr, end);
+		if (ptr == NULL || ptr >= end) return NULL;
 
 		if (*ptr == '}') {
 			ptr++; // 跳过 '}'
@@ -68,21 +186,21 @@ static const char* parse_json_object(const char* ptr, JsonObject* obj) {
 
 		if (*ptr == ',') {
 			ptr++;
-			ptr = skip_whitespace(ptr);
-			if (ptr == NULL || *ptr == '\0') return NULL;
+			ptr = skip_whitespace_n(ptr, end);
+			if (ptr == NULL || ptr >= end) return NULL;
 		}
 
 		// 解析键
-		if (*ptr != '"') {
+		if (ptr >= end || *ptr != '"') {
 			return NULL;
 		}
 
 		ptr++; // 跳过 '"'
-		if (ptr == NULL || *ptr == '\0') return NULL;
+		if (ptr == NULL || ptr >= end) return NULL;
 
 		const char* key_start = ptr;
-		while (*ptr && *ptr != '"') ptr++;
-		if (*ptr != '"') {
+		while (ptr < end && *ptr != '"') ptr++;
+		if (ptr >= end || *ptr != '"') {
 			return NULL;
 		}
 
@@ -90,8 +208,8 @@ static const char* parse_json_object(const char* ptr, JsonObject* obj) {
 		safe_strcpy(obj->values[obj->count].key, MAX_KEY_LENGTH, key_start, key_len);
 
 		ptr++; // 跳过 '"'
-		ptr = skip_whitespace(ptr);
-		if (ptr == NULL || *ptr == '\0') return NULL;
+		ptr = skip_whitespace_n(ptr, end);
+		if (ptr == NULL || ptr >= end) return NULL;
 
 		if (*ptr != ':') {
 			return NULL;
@@ -100,13 +218,13 @@ static const char* parse_json_object(const char* ptr, JsonObject* obj) {
 		ptr++; // 跳过 ':'
 
 		// 解析值
-		ptr = parse_json_value(ptr, &obj->values[obj->count]);
+		ptr = parse_json_value(ptr, end, &obj->values[obj->count]);
 		if (ptr == NULL) {
 			return NULL;
 		}
 
 		obj->count++;
-		ptr = skip_whitespace(ptr);
+		ptr = skip_whitespace_n(ptr, end);
 		if (ptr == NULL) return NULL;
 	}
 
@@ -114,19 +232,19 @@ static const char* parse_json_object(const char* ptr, JsonObject* obj) {
 }
 
 // 解析 JSON 值（实现）
-static const char* parse_json_value(const char* ptr, JsonValue* value) {
+static const char* parse_json_value(const char* ptr, const char* end, JsonValue* value) {
 	if (ptr == NULL || value == NULL) return NULL;
 
-	ptr = skip_whitespace(ptr);
-	if (ptr == NULL || *ptr == '\0') return NULL;
+	ptr = skip_whitespace_n(ptr, end);
+	if (ptr == NULL || ptr >= end) return NULL;
 
 	if (*ptr == '"') {
 		// 字符串值
 		value->type = JSON_STRING;
 		ptr++; // 跳过 '"'
 		const char* value_start = ptr;
-		while (*ptr && *ptr != '"') ptr++;
-		if (*ptr != '"') return NULL;
+		while (ptr < end && *ptr != '"') ptr++;
+		if (ptr >= end || *ptr != '"') return NULL;
 
 		size_t value_len = ptr - value_start;
 		safe_strcpy(value->string_value, MAX_VALUE_LENGTH, value_start, value_len);
@@ -135,13 +253,13 @@ static const char* parse_json_value(const char* ptr, JsonValue* value) {
 	else if (*ptr == '{') {
 		// 嵌套对象
 		value->type = JSON_OBJECT;
-		JsonObject* nested_obj = (JsonObject*)malloc(sizeof(JsonObject));
+		JsonObject* nested_obj = (JsonObject*)json_alloc(sizeof(JsonObject));
 		if (nested_obj == NULL) return NULL;
 
 		clear_json_object(nested_obj);
-		ptr = parse_json_object(ptr, nested_obj);
+		ptr = parse_json_object(ptr, end, nested_obj);
 		if (ptr == NULL) {
-			free(nested_obj);
+			json_free(nested_obj);
 			return NULL;
 		}
 		value->object_value = nested_obj;
@@ -152,9 +270,9 @@ static const char* parse_json_value(const char* ptr, JsonValue* value) {
 		JsonArray* array = create_json_array();
 		if (array == NULL) return NULL;
 
-		ptr = parse_json_array(ptr, array);
+		ptr = parse_json_array(ptr, end, array);
 		if (ptr == NULL) {
-			free(array);
+			json_free(array);
 			return NULL;
 		}
 		value->array_value = array;
@@ -163,7 +281,7 @@ static const char* parse_json_value(const char* ptr, JsonValue* value) {
 		// 数字值
 		value->type = JSON_NUMBER;
 		const char* value_start = ptr;
-		while (*ptr && (*ptr == '-' || *ptr == '.' || isdigit((unsigned char)*ptr))) {
+		while (ptr < end && (*ptr == '-' || *ptr == '.' || isdigit((unsigned char)*ptr))) {
 			ptr++;
 		}
 
@@ -172,19 +290,19 @@ static const char* parse_json_value(const char* ptr, JsonValue* value) {
 		safe_strcpy(num_str, sizeof(num_str), value_start, value_len);
 		value->number_value = atof(num_str);
 	}
-	else if (strncmp(ptr, "true", 4) == 0) {
+	else if (match_literal(ptr, end, "true", 4)) {
 		// 布尔值 true
 		value->type = JSON_BOOLEAN;
 		value->bool_value = 1;
 		ptr += 4;
 	}
-	else if (strncmp(ptr, "false", 5) == 0) {
+	else if (match_literal(ptr, end, "false", 5)) {
 		// 布尔值 false
 		value->type = JSON_BOOLEAN;
 		value->bool_value = 0;
 		ptr += 5;
 	}
-	else if (strncmp(ptr, "null", 4) == 0) {
+	else if (match_literal(ptr, end, "null", 4)) {
 		// null 值
 		value->type = JSON_NULL;
 		ptr += 4;
@@ -203,10 +321,77 @@ int parse_json(const char* json_str, JsonObject* obj) {
 	}
 
 	// 使用对象解析函数
-	const char* result = parse_json_object(json_str, obj);
+	const char* result = parse_json_object(json_str, json_str + strlen(json_str), obj);
 	return (result != NULL);
 }
 
+// 解析指定长度的 JSON（不要求以 '\0' 结尾，不会读取 buf + len 之后的内容）
+int parse_json_n(const char* buf, size_t len, JsonObject* obj) {
+	if (buf == NULL || obj == NULL) {
+		return 0;
+	}
+
+	const char* end = buf + len;
+	const char* start = skip_whitespace_n(buf, end);
+	return parse_json_object(start, end, obj) != NULL;
+}
+
+// 解析 JSON 文件。文件以只读方式映射到内存后直接解析，不复制到堆上；
+// 解析结果不引用文件内容，返回前即解除映射
+// PrefetchVirtualMemory 的参数，与 WIN32_MEMORY_RANGE_ENTRY 布局相同
+typedef struct JsonPrefetchRange {
+	PVOID address;
+	SIZE_T bytes;
+} JsonPrefetchRange;
+
+typedef BOOL(WINAPI* JsonPrefetchFn)(HANDLE process, ULONG_PTR count, JsonPrefetchRange* ranges, ULONG flags);
+
+// 让系统提前把整个映射视图读入内存（相当于 madvise(MADV_WILLNEED)），
+// 避免顺序解析时逐页缺页。PrefetchVirtualMemory 从 Windows 8 开始提供，旧系统上直接跳过
+static void json_prefetch_view(const void* view, size_t size) {
+	HMODULE kernel = GetModuleHandleA("kernel32.dll");
+	JsonPrefetchFn prefetch = kernel ? (JsonPrefetchFn)GetProcAddress(kernel, "PrefetchVirtualMemory") : NULL;
+	if (prefetch != NULL) {
+		JsonPrefetchRange range = { (PVOID)view, size };
+		prefetch(GetCurrentProcess(), 1, &range, 0);
+	}
+}
+
+int parse_json_file(const char* path, JsonObject* obj) {
+	if (path == NULL || obj == NULL) {
+		return 0;
+	}
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return 0;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || (ULONGLONG)size.QuadPart > (SIZE_T)-1) {
+		CloseHandle(file);
+		return 0;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return 0;
+	}
+
+	const char* view = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == NULL) {
+		return 0;
+	}
+
+	json_prefetch_view(view, (size_t)size.QuadPart);
+	int ok = parse_json_n(view, (size_t)size.QuadPart, obj);
+	UnmapViewOfFile(view);
+	return ok;
+}
+
 // 获取 JSON 字符串值
 const char* get_json_string(const JsonObject* obj, const char* key) {
 	if (obj == NULL || key == NULL) return NULL;
@@ -256,24 +441,24 @@ JsonObject* get_json_object(const JsonObject* obj, const char* key) {
 }
 // 创建 JSON 数组
 JsonArray* create_json_array() {
-	JsonArray* array = (JsonArray*)malloc(sizeof(JsonArray));
+	JsonArray* array = (JsonArray*)json_alloc(sizeof(JsonArray));
 	if (array == NULL) return NULL;
 	array->count = 0;
 	return array;
 }
 
 // 解析 JSON 数组
-static const char* parse_json_array(const char* ptr, JsonArray* array) {
-	if (ptr == NULL || array == NULL || *ptr != '[') {
+static const char* parse_json_array(const char* ptr, const char* end, JsonArray* array) {
+	if (ptr == NULL || array == NULL || ptr >= end || *ptr != '[') {
 		return NULL;
 	}
 
 	array->count = 0;
 	ptr++; // 跳过 '['
 
-	while (*ptr && array->count < MAX_ARRAY_SIZE) {
-		ptr = skip_whitespace(ptr);
-		if (ptr == NULL || *ptr == '\0') return NULL;
+	while (ptr < end && array->count < MAX_ARRAY_SIZE) {
+		ptr = skip_whitespace_n(ptr, end);
+		if (ptr == NULL || ptr >= end) return NULL;
 
 		if (*ptr == ']') {
 			ptr++; // 跳过 ']'
@@ -282,21 +467,21 @@ static const char* parse_json_array(const char* ptr, JsonArray* array) {
 
 		if (*ptr == ',') {
 			ptr++;
-			ptr = skip_whitespace(ptr);
-			if (ptr == NULL || *ptr == '\0') return NULL;
+			ptr = skip_whitespace_n(ptr, end);
+			if (ptr == NULL || ptr >= end) return NULL;
 		}
 
 		// 根据元素类型解析
-		ptr = skip_whitespace(ptr);
-		if (ptr == NULL || *ptr == '\0') return NULL;
+		ptr = skip_whitespace_n(ptr, end);
+		if (ptr == NULL || ptr >= end) return NULL;
 
 		if (*ptr == '"') {
 			// 字符串元素
 			array->element_types[array->count] = JSON_STRING;
 			ptr++; // 跳过 '"'
 			const char* value_start = ptr;
-			while (*ptr && *ptr != '"') ptr++;
-			if (*ptr != '"') return NULL;
+			while (ptr < end && *ptr != '"') ptr++;
+			if (ptr >= end || *ptr != '"') return NULL;
 
 			size_t value_len = ptr - value_start;
 			safe_strcpy(array->string_values[array->count], MAX_VALUE_LENGTH, value_start, value_len);
@@ -305,13 +490,13 @@ static const char* parse_json_array(const char* ptr, JsonArray* array) {
 		else if (*ptr == '{') {
 			// 对象元素
 			array->element_types[array->count] = JSON_OBJECT;
-			JsonObject* nested_obj = (JsonObject*)malloc(sizeof(JsonObject));
+			JsonObject* nested_obj = (JsonObject*)json_alloc(sizeof(JsonObject));
 			if (nested_obj == NULL) return NULL;
 
 			clear_json_object(nested_obj);
-			ptr = parse_json_object(ptr, nested_obj);
+			ptr = parse_json_object(ptr, end, nested_obj);
 			if (ptr == NULL) {
-				free(nested_obj);
+				json_free(nested_obj);
 				return NULL;
 			}
 			array->object_values[array->count] = nested_obj;
@@ -320,7 +505,7 @@ static const char* parse_json_array(const char* ptr, JsonArray* array) {
 			// 数字元素
 			array->element_types[array->count] = JSON_NUMBER;
 			const char* value_start = ptr;
-			while (*ptr && (*ptr == '-' || *ptr == '.' || isdigit((unsigned char)*ptr))) {
+			while (ptr < end && (*ptr == '-' || *ptr == '.' || isdigit((unsigned char)*ptr))) {
 				ptr++;
 			}
 
@@ -329,19 +514,19 @@ static const char* parse_json_array(const char* ptr, JsonArray* array) {
 			safe_strcpy(num_str, sizeof(num_str), value_start, value_len);
 			array->number_values[array->count] = atof(num_str);
 		}
-		else if (strncmp(ptr, "true", 4) == 0) {
+		else if (match_literal(ptr, end, "true", 4)) {
 			// 布尔值 true
 			array->element_types[array->count] = JSON_BOOLEAN;
 			array->bool_values[array->count] = 1;
 			ptr += 4;
 		}
-		else if (strncmp(ptr, "false", 5) == 0) {
+		else if (match_literal(ptr, end, "false", 5)) {
 			// 布尔值 false
 			array->element_types[array->count] = JSON_BOOLEAN;
 			array->bool_values[array->count] = 0;
 			ptr += 5;
 		}
-		else if (strncmp(ptr, "null", 4) == 0) {
+		else if (match_literal(ptr, end, "null", 4)) {
 			// null 值
 			array->element_types[array->count] = JSON_NULL;
 			ptr += 4;
@@ -351,7 +536,7 @@ static const char* parse_json_array(const char* ptr, JsonArray* array) {
 		}
 
 		array->count++;
-		ptr = skip_whitespace(ptr);
+		ptr = skip_whitespace_n(ptr, end);
 		if (ptr == NULL) return NULL;
 	}
 
@@ -480,316 +665,3091 @@ void print_json_object(const JsonObject* obj, int indent) {
 	}
 }
 
-// [其余函数保持不变：URL编码、HTTP请求等]
-// ... 保持原有的 URL 编码、HTTP 请求等函数不变
-
-// URL 编码函数
-char* url_encode(const char* str) {
-	if (str == NULL) return NULL;
-
-	// 计算编码后的长度
-	size_t len = strlen(str);
-	size_t encoded_len = 0;
-
-	for (size_t i = 0; i < len; i++) {
-		unsigned char c = str[i];
-		if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-			encoded_len++;
-		}
-		else {
-			encoded_len += 3; // %XX
-		}
+// ==================== 磁带（tape）格式 ====================
+// 整个文档存放在一段连续的 64 位数组中：高 8 位为类型标记，低 56 位为负载。
+//   '{' / '['：低 32 位为匹配的结束标记之后的下标，32~55 位为子元素数量
+//   '}' / ']'：负载为对应开始标记的下标
+//   '"'：负载为字符串在 strings 中的偏移（4 字节长度 + 内容 + '\0'）
+//   'd'：数字，下一个字保存 double 的位模式
+//   't' / 'f' / 'n'：true / false / null
+// 对象中键和值交替存放，跳过任意子树只需读取开始标记中的下标。
+// 受编码宽度限制，单个容器最多 JSON_TAPE_MAX_COUNT 个子元素，磁带最多 2^32 - 1 个字，
+// 单个字符串最长 4GB - 1；超出时 json_tape_parse 失败而不是截断。
+
+#define JSON_TAPE_MAX_DEPTH 256
+#define JSON_TAPE_MAX_COUNT 0xFFFFFF
+#define JSON_TAPE_MAX_INDEX 0xFFFFFFFFULL
+#define TAPE_ENTRY(type, payload) (((unsigned long long)(type) << 56) | (unsigned long long)(payload))
+#define TAPE_TYPE(entry) ((char)((entry) >> 56))
+#define TAPE_PAYLOAD(entry) ((entry) & 0x00FFFFFFFFFFFFFFULL)
+
+static int tape_push(JsonTape* doc, unsigned long long entry) {
+	if (doc->tape_len == doc->tape_capacity) {
+		size_t capacity = doc->tape_capacity ? doc->tape_capacity * 2 : 64;
+		unsigned long long* tape = (unsigned long long*)realloc(doc->tape, capacity * sizeof(unsigned long long));
+		if (tape == NULL) return 0;
+		doc->tape = tape;
+		doc->tape_capacity = capacity;
 	}
+	doc->tape[doc->tape_len++] = entry;
+	return 1;
+}
 
-	// 分配内存
-	char* encoded = (char*)malloc(encoded_len + 1);
-	if (encoded == NULL) return NULL;
+// 把字符串追加到 strings，返回偏移，失败返回 (size_t)-1
+static size_t tape_push_string(JsonTape* doc, const char* str, size_t len) {
+	if ((unsigned long long)len > 0xFFFFFFFFULL) return (size_t)-1;
+
+	size_t need = doc->strings_len + 4 + len + 1;
+	if (need > doc->strings_capacity) {
+		size_t capacity = doc->strings_capacity ? doc->strings_capacity * 2 : 256;
+		while (capacity < need) capacity *= 2;
+		char* strings = (char*)realloc(doc->strings, capacity);
+		if (strings == NULL) return (size_t)-1;
+		doc->strings = strings;
+		doc->strings_capacity = capacity;
+	}
 
-	// 进行编码
-	size_t pos = 0;
-	for (size_t i = 0; i < len; i++) {
-		unsigned char c = str[i];
+	size_t offset = doc->strings_len;
+	unsigned int len32 = (unsigned int)len;
+	memcpy(doc->strings + offset, &len32, 4);
+	memcpy(doc->strings + offset + 4, str, len);
+	doc->strings[offset + 4 + len] = '\0';
+	doc->strings_len = need;
+	return offset;
+}
 
-		if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-			// 不需要编码的字符
-			encoded[pos++] = c;
-		}
-		else {
-			// 需要编码的字符
-			sprintf_s(encoded + pos, encoded_len - pos + 1, "%%%02X", c);
-			pos += 3;
-		}
+// 扫描字符串（ptr 指向开头的 '"'），跳过转义字符，返回结尾 '"' 的位置
+static const char* tape_scan_string(const char* ptr, const char* end) {
+	ptr++;
+	while (ptr < end && *ptr != '"') {
+		if (*ptr == '\\') ptr++;
+		ptr++;
 	}
-
-	encoded[pos] = '\0';
-	return encoded;
+	return ptr < end ? ptr : NULL;
 }
 
-// URL 解码函数
-char* url_decode(const char* str) {
-	if (str == NULL) return NULL;
+static const char* tape_parse_value(JsonTape* doc, const char* ptr, const char* end, int depth);
 
-	size_t len = strlen(str);
-	char* decoded = (char*)malloc(len + 1);
-	if (decoded == NULL) return NULL;
+// 解析对象或数组
+static const char* tape_parse_container(JsonTape* doc, const char* ptr, const char* end, int depth) {
+	if (depth > JSON_TAPE_MAX_DEPTH) return NULL;
 
-	size_t pos = 0;
-	for (size_t i = 0; i < len; i++) {
-		if (str[i] == '%' && i + 2 < len) {
-			// 处理 %XX 格式
-			char hex[3] = { str[i + 1], str[i + 2], '\0' };
-			int value;
-			if (sscanf_s(hex, "%02x", &value) == 1) {
-				decoded[pos++] = (char)value;
-				i += 2;
+	char open = *ptr;
+	char close = open == '{' ? '}' : ']';
+	size_t start = doc->tape_len;
+	size_t count = 0;
+	if (!tape_push(doc, TAPE_ENTRY(open, 0))) return NULL;
+	ptr++;
+
+	ptr = skip_whitespace_n(ptr, end);
+	if (ptr < end && *ptr == close) {
+		ptr++;
+	}
+	else {
+		for (;;) {
+			if (open == '{') {
+				// 键
+				if (ptr >= end || *ptr != '"') return NULL;
+				const char* key_end = tape_scan_string(ptr, end);
+				if (key_end == NULL) return NULL;
+				size_t offset = tape_push_string(doc, ptr + 1, key_end - ptr - 1);
+				if (offset == (size_t)-1 || !tape_push(doc, TAPE_ENTRY('"', offset))) return NULL;
+
+				ptr = skip_whitespace_n(key_end + 1, end);
+				if (ptr >= end || *ptr != ':') return NULL;
+				ptr++;
 			}
-			else {
-				decoded[pos++] = str[i];
+
+			ptr = tape_parse_value(doc, skip_whitespace_n(ptr, end), end, depth + 1);
+			if (ptr == NULL || ++count > JSON_TAPE_MAX_COUNT) return NULL;
+
+			ptr = skip_whitespace_n(ptr, end);
+			if (ptr >= end) return NULL;
+			if (*ptr == ',') {
+				ptr = skip_whitespace_n(ptr + 1, end);
+				continue;
 			}
-		}
-		else if (str[i] == '+') {
-			// + 号解码为空格
-			decoded[pos++] = ' ';
-		}
-		else {
-			decoded[pos++] = str[i];
+			if (*ptr != close) return NULL;
+			ptr++;
+			break;
 		}
 	}
 
-	decoded[pos] = '\0';
-	return decoded;
+	if (!tape_push(doc, TAPE_ENTRY(close, start))) return NULL;
+	if ((unsigned long long)doc->tape_len > JSON_TAPE_MAX_INDEX) return NULL;
+	doc->tape[start] = TAPE_ENTRY(open, ((unsigned long long)count << 32) | doc->tape_len);
+	return ptr;
 }
 
-// UTF-8 转 GBK 转换函数
-char* utf8_to_gbk(const char* utf8_str) {
-	if (utf8_str == NULL || strlen(utf8_str) == 0) {
-		return NULL;
-	}
+static const char* tape_parse_value(JsonTape* doc, const char* ptr, const char* end, int depth) {
+	if (ptr >= end) return NULL;
 
-	// UTF-8 转 Unicode
-	int wlen = MultiByteToWideChar(CP_UTF8, 0, utf8_str, -1, NULL, 0);
-	if (wlen == 0) {
-		return NULL;
+	if (*ptr == '{' || *ptr == '[') {
+		return tape_parse_container(doc, ptr, end, depth);
 	}
-
-	wchar_t* wstr = (wchar_t*)malloc(wlen * sizeof(wchar_t));
-	if (wstr == NULL) {
-		return NULL;
+	if (*ptr == '"') {
+		const char* str_end = tape_scan_string(ptr, end);
+		if (str_end == NULL) return NULL;
+		size_t offset = tape_push_string(doc, ptr + 1, str_end - ptr - 1);
+		if (offset == (size_t)-1 || !tape_push(doc, TAPE_ENTRY('"', offset))) return NULL;
+		return str_end + 1;
 	}
+	if (isdigit((unsigned char)*ptr) || *ptr == '-' || *ptr == '.') {
+		const char* value_start = ptr;
+		while (ptr < end && (isdigit((unsigned char)*ptr) || *ptr == '-' || *ptr == '+' ||
+			*ptr == '.' || *ptr == 'e' || *ptr == 'E')) {
+			ptr++;
+		}
 
-	if (MultiByteToWideChar(CP_UTF8, 0, utf8_str, -1, wstr, wlen) == 0) {
-		free(wstr);
-		return NULL;
+		char num_str[64];
+		safe_strcpy(num_str, sizeof(num_str), value_start, ptr - value_start);
+		double number = atof(num_str);
+		unsigned long long bits;
+		memcpy(&bits, &number, sizeof(bits));
+		if (!tape_push(doc, TAPE_ENTRY('d', 0)) || !tape_push(doc, bits)) return NULL;
+		return ptr;
 	}
-
-	// Unicode 转 GBK
-	int glen = WideCharToMultiByte(CP_ACP, 0, wstr, -1, NULL, 0, NULL, NULL);
-	if (glen == 0) {
-		free(wstr);
-		return NULL;
+	if (match_literal(ptr, end, "true", 4)) {
+		return tape_push(doc, TAPE_ENTRY('t', 0)) ? ptr + 4 : NULL;
 	}
-
-	char* gbk_str = (char*)malloc(glen);
-	if (gbk_str == NULL) {
-		free(wstr);
-		return NULL;
+	if (match_literal(ptr, end, "false", 5)) {
+		return tape_push(doc, TAPE_ENTRY('f', 0)) ? ptr + 5 : NULL;
+	}
+	if (match_literal(ptr, end, "null", 4)) {
+		return tape_push(doc, TAPE_ENTRY('n', 0)) ? ptr + 4 : NULL;
 	}
+	return NULL; // 未知类型
+}
 
-	if (WideCharToMultiByte(CP_ACP, 0, wstr, -1, gbk_str, glen, NULL, NULL) == 0) {
-		free(wstr);
-		free(gbk_str);
-		return NULL;
+// 解析为磁带格式，根可以是对象或数组。成功返回 1，文档用完后调用 json_tape_free
+int json_tape_parse(const char* buf, size_t len, JsonTape* doc) {
+	if (buf == NULL || doc == NULL) return 0;
+
+	memset(doc, 0, sizeof(*doc));
+	const char* end = buf + len;
+	const char* ptr = skip_whitespace_n(buf, end);
+	if (ptr >= end || (*ptr != '{' && *ptr != '[')) return 0;
+
+	// 磁带从小容量开始按倍数扩容，不按输入长度预留，避免稀疏 JSON 多占内存
+	if (tape_parse_container(doc, ptr, end, 0) == NULL) {
+		json_tape_free(doc);
+		return 0;
 	}
+	return 1;
+}
 
-	free(wstr);
-	return gbk_str;
+void json_tape_free(JsonTape* doc) {
+	if (doc == NULL) return;
+	free(doc->tape);
+	free(doc->strings);
+	memset(doc, 0, sizeof(*doc));
 }
 
-// 直接打印 UTF-8 字符串为 GBK
-void print_utf8_as_gbk(const char* utf8_str) {
-	if (utf8_str == NULL) {
-		return;
+// 值的类型
+JsonValueType json_tape_type(const JsonTape* doc, size_t ref) {
+	switch (TAPE_TYPE(doc->tape[ref])) {
+	case '{': return JSON_OBJECT;
+	case '[': return JSON_ARRAY;
+	case '"': return JSON_STRING;
+	case 'd': return JSON_NUMBER;
+	case 't':
+	case 'f': return JSON_BOOLEAN;
+	default: return JSON_NULL;
 	}
+}
 
-	char* gbk_str = utf8_to_gbk(utf8_str);
-	if (gbk_str != NULL) {
-		printf("%s", gbk_str);
-		free(gbk_str);
-	}
-	else {
-		// 转换失败，直接输出（可能会有乱码）
-		printf("%s", utf8_str);
+// 下一个兄弟元素的下标（跳过整个子树）
+size_t json_tape_next(const JsonTape* doc, size_t ref) {
+	unsigned long long entry = doc->tape[ref];
+	switch (TAPE_TYPE(entry)) {
+	case '{':
+	case '[': return (size_t)(entry & 0xFFFFFFFFULL);
+	case 'd': return ref + 2;
+	default: return ref + 1;
 	}
 }
 
-// 构建查询字符串 (key1=value1&key2=value2)，自动进行 URL 编码
-char* build_query_string(const char** params, int param_count) {
-	if (params == NULL || param_count <= 0) {
-		return NULL;
-	}
+// 对象或数组的子元素数量
+size_t json_tape_count(const JsonTape* doc, size_t ref) {
+	char type = TAPE_TYPE(doc->tape[ref]);
+	if (type != '{' && type != '[') return 0;
+	return (size_t)((TAPE_PAYLOAD(doc->tape[ref]) >> 32) & 0xFFFFFF);
+}
 
-	// 第一遍：计算总长度
-	size_t total_len = 0;
-	for (int i = 0; i < param_count; i += 2) {
-		if (params[i] != NULL) {
-			// 键和值都需要编码
-			char* encoded_key = url_encode(params[i]);
-			char* encoded_value = url_encode(params[i + 1]);
+const char* json_tape_string(const JsonTape* doc, size_t ref, size_t* len) {
+	if (TAPE_TYPE(doc->tape[ref]) != '"') return NULL;
 
-			if (encoded_key) total_len += strlen(encoded_key);
-			total_len += 1; // '='
-			if (encoded_value) total_len += strlen(encoded_value);
-			if (i + 2 < param_count) total_len += 1; // '&'
+	const char* p = doc->strings + TAPE_PAYLOAD(doc->tape[ref]);
+	unsigned int len32;
+	memcpy(&len32, p, 4);
+	if (len) *len = len32;
+	return p + 4;
+}
 
-			free(encoded_key);
-			free(encoded_value);
+double json_tape_number(const JsonTape* doc, size_t ref) {
+	if (TAPE_TYPE(doc->tape[ref]) != 'd') return 0.0;
+
+	double number;
+	memcpy(&number, &doc->tape[ref + 1], sizeof(number));
+	return number;
+}
+
+int json_tape_bool(const JsonTape* doc, size_t ref) {
+	return TAPE_TYPE(doc->tape[ref]) == 't';
+}
+
+// 开始遍历对象或数组，ref 不是容器时返回 0
+int json_tape_iter_begin(const JsonTape* doc, size_t ref, JsonTapeIter* iter) {
+	char type = TAPE_TYPE(doc->tape[ref]);
+	if (type != '{' && type != '[') return 0;
+
+	iter->doc = doc;
+	iter->pos = ref + 1;
+	iter->end = json_tape_next(doc, ref) - 1; // 结束标记的下标
+	return 1;
+}
+
+// 取数组的下一个元素，结束时返回 0
+int json_tape_array_next(JsonTapeIter* iter, size_t* value) {
+	if (iter->pos >= iter->end) return 0;
+
+	*value = iter->pos;
+	iter->pos = json_tape_next(iter->doc, iter->pos);
+	return 1;
+}
+
+// 取对象的下一个键值对，结束时返回 0
+int json_tape_object_next(JsonTapeIter* iter, const char** key, size_t* key_len, size_t* value) {
+	if (iter->pos >= iter->end) return 0;
+
+	*key = json_tape_string(iter->doc, iter->pos, key_len);
+	*value = iter->pos + 1;
+	iter->pos = json_tape_next(iter->doc, iter->pos + 1);
+	return 1;
+}
+
+// 在对象中查找键，返回值的下标，找不到返回 JSON_TAPE_NONE
+size_t json_tape_find(const JsonTape* doc, size_t object_ref, const char* key) {
+	JsonTapeIter iter;
+	const char* name;
+	size_t name_len;
+	size_t value;
+	size_t key_len = strlen(key);
+
+	if (TAPE_TYPE(doc->tape[object_ref]) != '{' || !json_tape_iter_begin(doc, object_ref, &iter)) {
+		return JSON_TAPE_NONE;
+	}
+	while (json_tape_object_next(&iter, &name, &name_len, &value)) {
+		if (name_len == key_len && memcmp(name, key, key_len) == 0) {
+			return value;
 		}
 	}
+	return JSON_TAPE_NONE;
+}
 
-	if (total_len == 0) {
-		return NULL;
-	}
+// ==================== 按描述表直接解析到结构体 ====================
+// 调用者用 JsonFieldDesc 描述结构体的字段（键、类型、偏移），解析时一次扫描直接写入结构体，
+// 不构建 JsonObject。键通过预先计算的完美哈希匹配，未知的键整体跳过。
 
-	// 分配内存并构建字符串
-	char* query = (char*)malloc(total_len + 1);
-	if (query == NULL) {
-		return NULL;
+static unsigned int json_schema_hash(const char* key, size_t len, unsigned int seed) {
+	unsigned int h = 2166136261u ^ seed;
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char)key[i];
+		h *= 16777619u;
 	}
+	return h ^ (h >> 15);
+}
 
-	query[0] = '\0';
-	for (int i = 0; i < param_count; i += 2) {
-		if (params[i] != NULL) {
-			if (i > 0) {
-				strcat_s(query, total_len + 1, "&");
-			}
+// 为描述表计算完美哈希（每个键落在不同的槽）。成功返回 1；
+// 首次解析时会自动调用，多线程共用同一描述表时请先调用一次
+int json_schema_prepare(JsonSchema* schema) {
+	if (schema == NULL || schema->field_count < 0 || schema->field_count > JSON_SCHEMA_MAX_FIELDS) {
+		return 0;
+	}
+	if (schema->prepared) return 1;
 
-			char* encoded_key = url_encode(params[i]);
-			char* encoded_value = url_encode(params[i + 1]);
+	// 嵌套的描述表一并准备
+	for (int i = 0; i < schema->field_count; i++) {
+		if (schema->fields[i].schema != NULL && !json_schema_prepare(schema->fields[i].schema)) {
+			return 0;
+		}
+	}
 
-			if (encoded_key) {
-				strcat_s(query, total_len + 1, encoded_key);
-				strcat_s(query, total_len + 1, "=");
-				if (encoded_value) {
-					strcat_s(query, total_len + 1, encoded_value);
+	unsigned int size = 8;
+	while (size < (unsigned int)schema->field_count * 2) size *= 2;
+
+	for (; size <= sizeof(schema->slots); size *= 2) {
+		for (unsigned int seed = 1; seed < 4096; seed++) {
+			int collision = 0;
+			memset(schema->slots, 0, sizeof(schema->slots));
+			for (int i = 0; i < schema->field_count && !collision; i++) {
+				const char* key = schema->fields[i].key;
+				unsigned int slot = json_schema_hash(key, strlen(key), seed) & (size - 1);
+				if (schema->slots[slot] != 0) {
+					collision = 1;
+				}
+				else {
+					schema->slots[slot] = (unsigned char)(i + 1);
 				}
 			}
-
-			free(encoded_key);
-			free(encoded_value);
+			if (!collision) {
+				schema->seed = seed;
+				schema->mask = size - 1;
+				schema->prepared = 1;
+				return 1;
+			}
 		}
 	}
-
-	return query;
+	return 0;
 }
 
-// 内部 HTTP 请求函数
-static const char* http_request(const char* hostname, const char* port, const char* path,
-	const char* method, const char* content_type, const char* data) {
-	WSADATA wsa;
-	SOCKET sock;
-	struct addrinfo hints, *result, *ptr;
-	char request[4096];
-	static char response[8192];
-	int bytes_received;
-	int iResult;
-	int total_received = 0;
+// 按键查找字段，找不到返回 NULL
+static const JsonFieldDesc* json_schema_lookup(const JsonSchema* schema, const char* key, size_t len) {
+	unsigned int slot = json_schema_hash(key, len, schema->seed) & schema->mask;
+	int index = schema->slots[slot];
+	if (index == 0) return NULL;
 
-	// 初始化缓冲区
-	memset(response, 0, sizeof(response));
+	const JsonFieldDesc* field = &schema->fields[index - 1];
+	if (strncmp(field->key, key, len) != 0 || field->key[len] != '\0') return NULL;
+	return field;
+}
 
-	// 初始化 Winsock
-	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-		return "WSAStartup failed";
+// 跳过一个值（包括整个对象或数组），返回其后的位置
+static const char* json_skip_value(const char* ptr, const char* end) {
+	if (ptr >= end) return NULL;
+
+	if (*ptr == '"') {
+		const char* str_end = tape_scan_string(ptr, end);
+		return str_end ? str_end + 1 : NULL;
 	}
 
-	// 设置 addrinfo 提示
+	if (*ptr == '{' || *ptr == '[') {
+		int depth = 0;
+		while (ptr < end) {
+			char c = *ptr;
+			if (c == '"') {
+				ptr = tape_scan_string(ptr, end);
+				if (ptr == NULL) return NULL;
+			}
+			else if (c == '{' || c == '[') {
+				depth++;
+			}
+			else if (c == '}' || c == ']') {
+				if (--depth == 0) return ptr + 1;
+			}
+			ptr++;
+		}
+		return NULL;
+	}
+
+	// 数字和字面量
+	const char* start = ptr;
+	while (ptr < end && *ptr != ',' && *ptr != '}' && *ptr != ']' && !isspace((unsigned char)*ptr)) {
+		ptr++;
+	}
+	return ptr > start ? ptr : NULL;
+}
+
+static const char* json_bind_object(const char* ptr, const char* end, const JsonSchema* schema, char* base);
+
+// 解析一个标量或嵌套对象并写入 dest；类型不符时跳过该值。
+// stored 不为 NULL 时，写入了 dest 则置 1，跳过则保持不变
+static const char* json_bind_scalar(const char* ptr, const char* end, JsonFieldType type,
+	size_t size, const JsonSchema* schema, char* dest, int* stored) {
+	int ignored;
+	if (ptr >= end) return NULL;
+	if (stored == NULL) stored = &ignored;
+
+	switch (type) {
+	case JSON_FIELD_STRING:
+		if (*ptr == '"') {
+			const char* str_end = tape_scan_string(ptr, end);
+			if (str_end == NULL) return NULL;
+			safe_strcpy(dest, size, ptr + 1, str_end - ptr - 1);
+			*stored = 1;
+			return str_end + 1;
+		}
+		break;
+	case JSON_FIELD_NUMBER:
+	case JSON_FIELD_INT:
+		if (isdigit((unsigned char)*ptr) || *ptr == '-' || *ptr == '.') {
+			const char* value_start = ptr;
+			while (ptr < end && (isdigit((unsigned char)*ptr) || *ptr == '-' || *ptr == '+' ||
+				*ptr == '.' || *ptr == 'e' || *ptr == 'E')) {
+				ptr++;
+			}
+			char num_str[64];
+			safe_strcpy(num_str, sizeof(num_str), value_start, ptr - value_start);
+			if (type == JSON_FIELD_NUMBER) {
+				*(double*)dest = atof(num_str);
+			}
+			else {
+				// 超出 int 范围的值截断到边界，和超长字符串截断一样处理
+				double value = atof(num_str);
+				if (value >= (double)INT_MAX) *(int*)dest = INT_MAX;
+				else if (value <= (double)INT_MIN) *(int*)dest = INT_MIN;
+				else *(int*)dest = (int)value;
+			}
+			*stored = 1;
+			return ptr;
+		}
+		break;
+	case JSON_FIELD_BOOL:
+		if (match_literal(ptr, end, "true", 4)) {
+			*(int*)dest = 1;
+			*stored = 1;
+			return ptr + 4;
+		}
+		if (match_literal(ptr, end, "false", 5)) {
+			*(int*)dest = 0;
+			*stored = 1;
+			return ptr + 5;
+		}
+		break;
+	case JSON_FIELD_OBJECT:
+		if (*ptr == '{' && schema != NULL) {
+			*stored = 1;
+			return json_bind_object(ptr, end, schema, dest);
+		}
+		break;
+	default:
+		break;
+	}
+	return json_skip_value(ptr, end);
+}
+
+// 解析数组，元素依次写入 base + field->offset，数量写入 base + field->count_offset
+static const char* json_bind_array(const char* ptr, const char* end, const JsonFieldDesc* field, char* base) {
+	if (ptr >= end) return NULL;
+	if (*ptr != '[') return json_skip_value(ptr, end);
+
+	int count = 0;
+	ptr = skip_whitespace_n(ptr + 1, end);
+	if (ptr < end && *ptr == ']') {
+		ptr++;
+	}
+	else {
+		for (;;) {
+			if (count < field->max_count) {
+				// 类型不符的元素被跳过，不占位置
+				char* dest = base + field->offset + (size_t)count * field->size;
+				int stored = 0;
+				ptr = json_bind_scalar(ptr, end, field->element_type, field->size, field->schema, dest, &stored);
+				count += stored;
+			}
+			else {
+				// 超出容量的元素忽略
+				ptr = json_skip_value(ptr, end);
+			}
+			if (ptr == NULL) return NULL;
+
+			ptr = skip_whitespace_n(ptr, end);
+			if (ptr >= end) return NULL;
+			if (*ptr == ',') {
+				ptr = skip_whitespace_n(ptr + 1, end);
+				continue;
+			}
+			if (*ptr != ']') return NULL;
+			ptr++;
+			break;
+		}
+	}
+
+	*(int*)(base + field->count_offset) = count;
+	return ptr;
+}
+
+static const char* json_bind_object(const char* ptr, const char* end, const JsonSchema* schema, char* base) {
+	if (ptr >= end || *ptr != '{') return NULL;
+
+	ptr = skip_whitespace_n(ptr + 1, end);
+	if (ptr < end && *ptr == '}') return ptr + 1;
+
+	for (;;) {
+		if (ptr >= end || *ptr != '"') return NULL;
+		const char* key_end = tape_scan_string(ptr, end);
+		if (key_end == NULL) return NULL;
+		const JsonFieldDesc* field = json_schema_lookup(schema, ptr + 1, key_end - ptr - 1);
+
+		ptr = skip_whitespace_n(key_end + 1, end);
+		if (ptr >= end || *ptr != ':') return NULL;
+		ptr = skip_whitespace_n(ptr + 1, end);
+
+		if (field == NULL) {
+			ptr = json_skip_value(ptr, end);
+		}
+		else if (field->type == JSON_FIELD_ARRAY) {
+			ptr = json_bind_array(ptr, end, field, base);
+		}
+		else {
+			ptr = json_bind_scalar(ptr, end, field->type, field->size, field->schema, base + field->offset, NULL);
+		}
+		if (ptr == NULL) return NULL;
+
+		ptr = skip_whitespace_n(ptr, end);
+		if (ptr >= end) return NULL;
+		if (*ptr == ',') {
+			ptr = skip_whitespace_n(ptr + 1, end);
+			continue;
+		}
+		if (*ptr != '}') return NULL;
+		return ptr + 1;
+	}
+}
+
+// 按描述表把 JSON 对象直接解析到 out 指向的结构体。
+// 结构体中没有出现在 JSON 里的字段保持原值。成功返回 1
+int json_bind(const char* buf, size_t len, JsonSchema* schema, void* out) {
+	if (buf == NULL || schema == NULL || out == NULL) return 0;
+	if (!schema->prepared && !json_schema_prepare(schema)) return 0;
+
+	const char* end = buf + len;
+	return json_bind_object(skip_whitespace_n(buf, end), end, schema, (char*)out) != NULL;
+}
+
+// ==================== NDJSON 并行解析 ====================
+// 输入按字节切分成若干块（块边界对齐到换行符），工作线程并行解析各块，
+// 每个线程的解析结果放在自己的 arena 中。回调在锁内串行调用。
+
+#define NDJSON_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define NDJSON_MAX_THREADS 64
+
+typedef struct NdjsonRecord {
+	JsonObject* obj;            // 解析失败时为 NULL
+	size_t offset;
+	struct NdjsonRecord* next;
+} NdjsonRecord;
+
+typedef struct NdjsonContext {
+	const char* data;
+	size_t* chunk_starts;       // 第 i 块为 [chunk_starts[i], chunk_starts[i + 1])
+	LONG chunk_count;
+	volatile LONG next_chunk;
+	int ordered;
+	volatile int stop;
+	LONG next_deliver;          // 有序模式下轮到交付的块
+	long long delivered;
+	SRWLOCK lock;
+	CONDITION_VARIABLE turn;
+	NdjsonCallback callback;
+	void* user_data;
+} NdjsonContext;
+
+// 交付一条记录（调用者持有锁）
+static void ndjson_deliver(NdjsonContext* ctx, const NdjsonRecord* record) {
+	if (ctx->stop) return;
+
+	// 回调中的 parse_json 等调用必须使用普通堆内存，不能分配到本线程的解析区
+	JsonArena* arena = g_json_arena;
+	g_json_arena = NULL;
+
+	ctx->delivered++;
+	int keep_going = ctx->callback(record->obj, record->offset, ctx->user_data);
+	g_json_arena = arena;
+
+	if (!keep_going) {
+		ctx->stop = 1;
+		WakeAllConditionVariable(&ctx->turn);
+	}
+}
+
+// 解析一行，空行返回 0
+static int ndjson_parse_line(const char* line, size_t len, NdjsonRecord* record) {
+	while (len > 0 && isspace((unsigned char)line[len - 1])) len--;
+	while (len > 0 && isspace((unsigned char)*line)) {
+		line++;
+		len--;
+	}
+	if (len == 0) return 0;
+
+	JsonObject* obj = (JsonObject*)json_alloc(sizeof(JsonObject));
+	record->obj = NULL;
+	if (obj == NULL) return 1;
+
+	clear_json_object(obj);
+	if (parse_json_n(line, len, obj)) {
+		record->obj = obj;
+	}
+	return 1;
+}
+
+static unsigned __stdcall ndjson_worker(void* arg) {
+	NdjsonContext* ctx = (NdjsonContext*)arg;
+	JsonArena arena = { NULL, NULL };
+	g_json_arena = &arena;
+
+	for (;;) {
+		LONG chunk = InterlockedIncrement(&ctx->next_chunk) - 1;
+		if (chunk >= ctx->chunk_count) break;
+
+		const char* p = ctx->data + ctx->chunk_starts[chunk];
+		const char* end = ctx->data + ctx->chunk_starts[chunk + 1];
+		NdjsonRecord* head = NULL;
+		NdjsonRecord** tail = &head;
+		json_arena_reset(&arena);
+
+		while (p < end && !ctx->stop) {
+			const char* nl = (const char*)memchr(p, '\n', end - p);
+			const char* line_end = nl ? nl : end;
+
+			NdjsonRecord* record = (NdjsonRecord*)json_alloc(sizeof(NdjsonRecord));
+			if (record == NULL) break;
+			record->offset = p - ctx->data;
+			record->next = NULL;
+
+			if (ndjson_parse_line(p, line_end - p, record)) {
+				if (ctx->ordered) {
+					*tail = record;
+					tail = &record->next;
+				}
+				else {
+					// 无序模式：立即交付并回收内存
+					AcquireSRWLockExclusive(&ctx->lock);
+					ndjson_deliver(ctx, record);
+					ReleaseSRWLockExclusive(&ctx->lock);
+					json_arena_reset(&arena);
+				}
+			}
+			p = line_end + 1;
+		}
+
+		if (ctx->ordered) {
+			// 等前面的块交付完再交付本块
+			AcquireSRWLockExclusive(&ctx->lock);
+			while (ctx->next_deliver != chunk && !ctx->stop) {
+				SleepConditionVariableSRW(&ctx->turn, &ctx->lock, INFINITE, 0);
+			}
+			for (NdjsonRecord* record = head; record != NULL; record = record->next) {
+				ndjson_deliver(ctx, record);
+			}
+			ctx->next_deliver = chunk + 1;
+			WakeAllConditionVariable(&ctx->turn);
+			ReleaseSRWLockExclusive(&ctx->lock);
+		}
+	}
+
+	g_json_arena = NULL;
+	json_arena_destroy(&arena);
+	return 0;
+}
+
+// 并行解析 NDJSON（每行一个 JSON 对象）。每条记录调用一次 callback，
+// 记录解析失败时 record 为 NULL；callback 返回 0 停止解析。
+// record 只在回调期间有效。返回交付的记录数，参数错误返回 -1
+long long parse_ndjson(const char* data, size_t len, const NdjsonOptions* options,
+	NdjsonCallback callback, void* user_data) {
+	if (data == NULL || callback == NULL) return -1;
+
+	int threads = options ? options->threads : 0;
+	size_t chunk_size = options && options->chunk_size ? options->chunk_size : NDJSON_DEFAULT_CHUNK_SIZE;
+	if (threads <= 0) {
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		threads = (int)info.dwNumberOfProcessors;
+	}
+	if (threads > NDJSON_MAX_THREADS) threads = NDJSON_MAX_THREADS;
+
+	// 切分块，边界对齐到下一个换行符之后
+	size_t max_chunks = len / chunk_size + 2;
+	size_t* starts = (size_t*)malloc((max_chunks + 1) * sizeof(size_t));
+	if (starts == NULL) return -1;
+
+	LONG chunk_count = 0;
+	size_t pos = 0;
+	starts[0] = 0;
+	while (pos < len) {
+		size_t next = pos + chunk_size;
+		if (next >= len) {
+			next = len;
+		}
+		else {
+			const char* nl = (const char*)memchr(data + next, '\n', len - next);
+			next = nl ? (size_t)(nl - data) + 1 : len;
+		}
+		starts[++chunk_count] = next;
+		pos = next;
+	}
+
+	NdjsonContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.data = data;
+	ctx.chunk_starts = starts;
+	ctx.chunk_count = chunk_count;
+	ctx.ordered = options ? !options->unordered : 1;
+	ctx.callback = callback;
+	ctx.user_data = user_data;
+	InitializeSRWLock(&ctx.lock);
+	InitializeConditionVariable(&ctx.turn);
+
+	if (threads > chunk_count) threads = chunk_count;
+	if (threads <= 1) {
+		ndjson_worker(&ctx);
+	}
+	else {
+		HANDLE handles[NDJSON_MAX_THREADS];
+		int started = 0;
+		for (int i = 0; i < threads; i++) {
+			handles[started] = (HANDLE)_beginthreadex(NULL, 0, ndjson_worker, &ctx, 0, NULL);
+			if (handles[started] != NULL) started++;
+		}
+		if (started == 0) {
+			ndjson_worker(&ctx);
+		}
+		else {
+			WaitForMultipleObjects(started, handles, TRUE, INFINITE);
+			for (int i = 0; i < started; i++) {
+				CloseHandle(handles[i]);
+			}
+		}
+	}
+
+	free(starts);
+	return ctx.delivered;
+}
+
+// [其余函数保持不变：URL编码、HTTP请求等]
+// ... 保持原有的 URL 编码、HTTP 请求等函数不变
+
+// URL 编码函数
+char* url_encode(const char* str) {
+	if (str == NULL) return NULL;
+
+	// 计算编码后的长度
+	size_t len = strlen(str);
+	size_t encoded_len = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = str[i];
+		if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+			encoded_len++;
+		}
+		else {
+			encoded_len += 3; // %XX
+		}
+	}
+
+	// 分配内存
+	char* encoded = (char*)malloc(encoded_len + 1);
+	if (encoded == NULL) return NULL;
+
+	// 进行编码
+	size_t pos = 0;
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = str[i];
+
+		if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+			// 不需要编码的字符
+			encoded[pos++] = c;
+		}
+		else {
+			// 需要编码的字符
+			sprintf_s(encoded + pos, encoded_len - pos + 1, "%%%02X", c);
+			pos += 3;
+		}
+	}
+
+	encoded[pos] = '\0';
+	return encoded;
+}
+
+// URL 解码函数
+char* url_decode(const char* str) {
+	if (str == NULL) return NULL;
+
+	size_t len = strlen(str);
+	char* decoded = (char*)malloc(len + 1);
+	if (decoded == NULL) return NULL;
+
+	size_t pos = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (str[i] == '%' && i + 2 < len) {
+			// 处理 %XX 格式
+			char hex[3] = { str[i + 1], str[i + 2], '\0' };
+			int value;
+			if (sscanf_s(hex, "%02x", &value) == 1) {
+				decoded[pos++] = (char)value;
+				i += 2;
+			}
+			else {
+				decoded[pos++] = str[i];
+			}
+		}
+		else if (str[i] == '+') {
+			// + 号解码为空格
+			decoded[pos++] = ' ';
+		}
+		else {
+			decoded[pos++] = str[i];
+		}
+	}
+
+	decoded[pos] = '\0';
+	return decoded;
+}
+
+// 构建查询字符串 (key1=value1&key2=value2)，自动进行 URL 编码
+char* build_query_string(const char** params, int param_count) {
+	if (params == NULL || param_count <= 0) {
+		return NULL;
+	}
+
+	// 第一遍：计算总长度
+	size_t total_len = 0;
+	for (int i = 0; i < param_count; i += 2) {
+		if (params[i] != NULL) {
+			// 键和值都需要编码
+			char* encoded_key = url_encode(params[i]);
+			char* encoded_value = url_encode(params[i + 1]);
+
+			if (encoded_key) total_len += strlen(encoded_key);
+			total_len += 1; // '='
+			if (encoded_value) total_len += strlen(encoded_value);
+			if (i + 2 < param_count) total_len += 1; // '&'
+
+			free(encoded_key);
+			free(encoded_value);
+		}
+	}
+
+	if (total_len == 0) {
+		return NULL;
+	}
+
+	// 分配内存并构建字符串
+	char* query = (char*)malloc(total_len + 1);
+	if (query == NULL) {
+		return NULL;
+	}
+
+	query[0] = '\0';
+	for (int i = 0; i < param_count; i += 2) {
+		if (params[i] != NULL) {
+			if (i > 0) {
+				strcat_s(query, total_len + 1, "&");
+			}
+
+			char* encoded_key = url_encode(params[i]);
+			char* encoded_value = url_encode(params[i + 1]);
+
+			if (encoded_key) {
+				strcat_s(query, total_len + 1, encoded_key);
+				strcat_s(query, total_len + 1, "=");
+				if (encoded_value) {
+					strcat_s(query, total_len + 1, encoded_value);
+				}
+			}
+
+			free(encoded_key);
+			free(encoded_value);
+		}
+	}
+
+	return query;
+}
+
+// 响应缓冲区（http_get 等函数返回的指针指向这里，每个线程一份）
+static __declspec(thread) char response[8192];
+
+// 运行统计（使用 Interlocked 函数更新）
+static volatile LONG g_stat_requests;         // 实际发出的网络请求
+static volatile LONG g_stat_coalesced;        // 合并到进行中请求的次数
+static volatile LONG g_stat_cache_hits;       // 缓存新鲜命中
+static volatile LONG g_stat_cache_revalidated; // 304 重新验证成功
+
+// 建立 TCP 连接（包含 Winsock 初始化），失败时返回 INVALID_SOCKET 并设置 *error
+static SOCKET http_connect(const char* hostname, const char* port, const char** error) {
+	WSADATA wsa;
+	SOCKET sock;
+	struct addrinfo hints, *result, *ptr;
+
+	// 初始化 Winsock
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+		*error = "WSAStartup failed";
+		return INVALID_SOCKET;
+	}
+
+	// 设置 addrinfo 提示
 	memset(&hints, 0, sizeof(hints));
 	hints.ai_family = AF_INET;
 	hints.ai_socktype = SOCK_STREAM;
 	hints.ai_protocol = IPPROTO_TCP;
 
-	// 解析地址和端口
-	iResult = getaddrinfo(hostname, port, &hints, &result);
-	if (iResult != 0) {
-		WSACleanup();
-		return "getaddrinfo failed";
+	// 解析地址和端口
+	if (getaddrinfo(hostname, port, &hints, &result) != 0) {
+		WSACleanup();
+		*error = "getaddrinfo failed";
+		return INVALID_SOCKET;
+	}
+
+	// 尝试每个返回的地址，直到成功连接
+	sock = INVALID_SOCKET;
+	for (ptr = result; ptr != NULL; ptr = ptr->ai_next) {
+		sock = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol);
+		if (sock == INVALID_SOCKET) {
+			continue;
+		}
+
+		if (connect(sock, ptr->ai_addr, (int)ptr->ai_addrlen) != SOCKET_ERROR) {
+			break;
+		}
+
+		closesocket(sock);
+		sock = INVALID_SOCKET;
+	}
+
+	freeaddrinfo(result);
+
+	if (sock == INVALID_SOCKET) {
+		WSACleanup();
+		*error = "Unable to connect to server";
+	}
+	return sock;
+}
+
+// 关闭连接
+static void http_disconnect(SOCKET sock) {
+	closesocket(sock);
+	WSACleanup();
+}
+
+// 发送全部数据。send 可能只发送一部分（发送缓冲区已满），此时继续发送剩余部分
+static int http_send_all(SOCKET sock, const char* data, size_t len) {
+	while (len > 0) {
+		int chunk = len > 0x40000000 ? 0x40000000 : (int)len;
+		int sent = send(sock, data, chunk, 0);
+		if (sent == SOCKET_ERROR) {
+			return 0;
+		}
+		data += sent;
+		len -= sent;
+	}
+	return 1;
+}
+
+// 接收响应直到连接关闭或缓冲区已满
+static const char* http_receive(SOCKET sock) {
+	int bytes_received;
+	int total_received = 0;
+
+	while ((bytes_received = recv(sock, response + total_received,
+		sizeof(response) - total_received - 1, 0)) > 0) {
+		total_received += bytes_received;
+		if (total_received >= sizeof(response) - 1) {
+			break;
+		}
+	}
+
+	response[total_received] = '\0';
+	return response;
+}
+
+static int http2_host_enabled(const char* hostname, const char* port);
+static const char* http2_request(const char* hostname, const char* port, const char* path,
+	const char* method, const char* content_type, const char* data, const char* extra_headers);
+
+// 内部 HTTP 请求函数（extra_headers 为附加的请求头，每行以 \r\n 结尾，可为 NULL）
+static const char* http_request(const char* hostname, const char* port, const char* path,
+	const char* method, const char* content_type, const char* data, const char* extra_headers) {
+	SOCKET sock;
+	const char* error = NULL;
+	char request[4096];
+
+	// 初始化缓冲区
+	memset(response, 0, sizeof(response));
+	InterlockedIncrement(&g_stat_requests);
+
+	// 登记为 h2c 的主机走 HTTP/2 连接复用
+	if (http2_host_enabled(hostname, port)) {
+		return http2_request(hostname, port, path, method, content_type, data, extra_headers);
+	}
+
+	sock = http_connect(hostname, port, &error);
+	if (sock == INVALID_SOCKET) {
+		return error;
+	}
+
+	// 构建请求
+	if (data != NULL && strcmp(method, "POST") == 0) {
+		// POST 请求
+		snprintf(request, sizeof(request),
+			"%s %s HTTP/1.1\r\n"
+			"Host: %s\r\n"
+			"User-Agent: C-HTTP-Client/1.0\r\n"
+			"Content-Type: %s\r\n"
+			"Content-Length: %d\r\n"
+			"%s"
+			"Connection: close\r\n"
+			"\r\n"
+			"%s",
+			method, path, hostname, content_type, (int)strlen(data),
+			extra_headers ? extra_headers : "", data);
+	}
+	else {
+		// GET 请求
+		snprintf(request, sizeof(request),
+			"%s %s HTTP/1.1\r\n"
+			"Host: %s\r\n"
+			"User-Agent: C-HTTP-Client/1.0\r\n"
+			"%s"
+			"Connection: close\r\n"
+			"\r\n",
+			method, path, hostname, extra_headers ? extra_headers : "");
+	}
+
+	// 发送请求
+	if (!http_send_all(sock, request, strlen(request))) {
+		http_disconnect(sock);
+		return "send failed";
+	}
+
+	// 接收响应
+	http_receive(sock);
+	http_disconnect(sock);
+
+	return response;
+}
+
+// ==================== 流式请求体 ====================
+// 请求体由回调分块提供，内存占用固定为一个缓冲区。长度已知时使用 Content-Length，
+// 否则使用 Transfer-Encoding: chunked。每块完全发送后才读取下一块，
+// 套接字发送缓冲区满时 send 阻塞，读取随之暂停。
+
+#define HTTP_STREAM_BUFFER_SIZE (16 * 1024)
+#define HTTP_CHUNK_HEADER_SIZE 10   // "FFFFFFFF\r\n"
+
+// 以流式请求体发送请求（method 通常为 POST 或 PUT）
+const char* http_send_stream(const char* hostname, const char* port, const char* path,
+	const char* method, const char* content_type, const HttpBodyProvider* body) {
+	SOCKET sock;
+	const char* error = NULL;
+	char header[2048];
+	char length_header[64];
+	static __declspec(thread) char buffer[HTTP_CHUNK_HEADER_SIZE + HTTP_STREAM_BUFFER_SIZE + 2];
+
+	if (body == NULL || body->read == NULL) {
+		return "invalid body provider";
+	}
+	// h2c 主机只接受 HTTP/2，而 HTTP/2 请求不支持流式请求体
+	if (http2_host_enabled(hostname, port)) {
+		return "streaming body is not supported over HTTP/2";
+	}
+
+	memset(response, 0, sizeof(response));
+	InterlockedIncrement(&g_stat_requests);
+
+	sock = http_connect(hostname, port, &error);
+	if (sock == INVALID_SOCKET) {
+		return error;
+	}
+
+	if (body->length >= 0) {
+		snprintf(length_header, sizeof(length_header), "Content-Length: %lld\r\n", body->length);
+	}
+	else {
+		snprintf(length_header, sizeof(length_header), "Transfer-Encoding: chunked\r\n");
+	}
+
+	int header_len = snprintf(header, sizeof(header),
+		"%s %s HTTP/1.1\r\n"
+		"Host: %s\r\n"
+		"User-Agent: C-HTTP-Client/1.0\r\n"
+		"Content-Type: %s\r\n"
+		"%s"
+		"Connection: close\r\n"
+		"\r\n",
+		method, path, hostname, content_type ? content_type : "application/octet-stream", length_header);
+	if (header_len < 0 || header_len >= (int)sizeof(header) || !http_send_all(sock, header, header_len)) {
+		http_disconnect(sock);
+		return "send failed";
+	}
+
+	long long sent = 0;
+	for (;;) {
+		size_t want = HTTP_STREAM_BUFFER_SIZE;
+		if (body->length >= 0 && (unsigned long long)(body->length - sent) < want) {
+			want = (size_t)(body->length - sent);
+		}
+		if (want == 0) break;
+
+		char* data = buffer + HTTP_CHUNK_HEADER_SIZE;
+		long n = body->read(body->user_data, data, want);
+		if (n < 0 || (size_t)n > want) {
+			http_disconnect(sock);
+			return "body read failed";
+		}
+		if (n == 0) {
+			if (body->length >= 0) {
+				// 提供的数据少于声明的 Content-Length，请求无法完成
+				http_disconnect(sock);
+				return "body shorter than Content-Length";
+			}
+			break;
+		}
+
+		if (body->length >= 0) {
+			if (!http_send_all(sock, data, n)) {
+				http_disconnect(sock);
+				return "send failed";
+			}
+		}
+		else {
+			// 块头写在数据前面预留的位置，块尾紧跟数据，一次发送
+			char size_line[HTTP_CHUNK_HEADER_SIZE + 1];
+			int size_len = snprintf(size_line, sizeof(size_line), "%lX\r\n", (unsigned long)n);
+			char* chunk = data - size_len;
+			memcpy(chunk, size_line, size_len);
+			data[n] = '\r';
+			data[n + 1] = '\n';
+			if (!http_send_all(sock, chunk, size_len + n + 2)) {
+				http_disconnect(sock);
+				return "send failed";
+			}
+		}
+		sent += n;
+	}
+
+	if (body->length < 0 && !http_send_all(sock, "0\r\n\r\n", 5)) {
+		http_disconnect(sock);
+		return "send failed";
+	}
+
+	http_receive(sock);
+	http_disconnect(sock);
+	return response;
+}
+
+// 以流式请求体发送 POST 请求
+const char* http_post_stream(const char* hostname, const char* port, const char* path,
+	const char* content_type, const HttpBodyProvider* body) {
+	return http_send_stream(hostname, port, path, "POST", content_type, body);
+}
+
+static long http_file_reader(void* user_data, char* buf, size_t size) {
+	DWORD bytes_read = 0;
+	if (!ReadFile((HANDLE)user_data, buf, (DWORD)size, &bytes_read, NULL)) {
+		return -1;
+	}
+	return (long)bytes_read;
+}
+
+// 上传文件内容（二进制安全，按文件大小发送 Content-Length）
+const char* http_post_file(const char* hostname, const char* port, const char* path,
+	const char* content_type, const char* file_path) {
+	HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return "Unable to open file";
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return "Unable to open file";
+	}
+
+	HttpBodyProvider body;
+	body.read = http_file_reader;
+	body.user_data = file;
+	body.length = size.QuadPart;
+
+	const char* resp = http_send_stream(hostname, port, path, "POST", content_type, &body);
+	CloseHandle(file);
+	return resp;
+}
+
+// 获取响应状态码，无法识别时返回 0
+int http_status_code(const char* resp) {
+	if (resp == NULL || strncmp(resp, "HTTP/", 5) != 0) return 0;
+
+	const char* sp = strchr(resp, ' ');
+	if (sp == NULL) return 0;
+	return atoi(sp + 1);
+}
+
+// 获取响应正文起始位置
+static const char* http_response_body(const char* resp) {
+	const char* header_end = strstr(resp, "\r\n\r\n");
+	return header_end ? header_end + 4 : NULL;
+}
+
+// 查找响应头（名称不区分大小写），找到时把值复制到 out 并返回 1
+static int http_find_header(const char* resp, const char* name, char* out, size_t out_size) {
+	const char* header_end = strstr(resp, "\r\n\r\n");
+	if (header_end == NULL) return 0;
+
+	size_t name_len = strlen(name);
+	const char* line = strstr(resp, "\r\n"); // 跳过状态行
+	while (line != NULL && line < header_end) {
+		line += 2;
+		if (_strnicmp(line, name, name_len) == 0 && line[name_len] == ':') {
+			const char* value = line + name_len + 1;
+			while (*value == ' ' || *value == '\t') value++;
+			const char* value_end = strstr(value, "\r\n");
+			safe_strcpy(out, out_size, value, value_end - value);
+			return 1;
+		}
+		line = strstr(line, "\r\n");
+	}
+	return 0;
+}
+
+// ==================== HTTP/2 明文传输（h2c prior knowledge） ====================
+// 对通过 http2_enable_host() 登记的主机，http_request 改走 HTTP/2：每个主机只建立一条连接，
+// 并发请求在这条连接上以不同的流（stream）复用。请求头用 HPACK 压缩，编码端的动态表
+// 在同一连接的所有请求之间共享。发送 DATA 时遵守连接级和流级的流量控制窗口。
+// 响应被转换成 HTTP/1.1 形式的文本（状态行 + 响应头 + 正文），调用方无需区分。
+// 一个后台线程负责读取连接上的所有帧并分发给对应的流；它只在持有连接锁时访问流，
+// 请求线程在同一把锁内摘下流之后即可安全释放。
+
+#define H2_FRAME_DATA 0x0
+#define H2_FRAME_HEADERS 0x1
+#define H2_FRAME_RST_STREAM 0x3
+#define H2_FRAME_SETTINGS 0x4
+#define H2_FRAME_PUSH_PROMISE 0x5
+#define H2_FRAME_PING 0x6
+#define H2_FRAME_GOAWAY 0x7
+#define H2_FRAME_WINDOW_UPDATE 0x8
+#define H2_FRAME_CONTINUATION 0x9
+
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+#define H2_FLAG_PRIORITY 0x20
+
+#define H2_SETTINGS_HEADER_TABLE_SIZE 0x1
+#define H2_SETTINGS_ENABLE_PUSH 0x2
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define H2_SETTINGS_MAX_FRAME_SIZE 0x5
+
+#define H2_DEFAULT_WINDOW 65535
+#define H2_LOCAL_WINDOW (1 << 20)       // 我方的接收窗口
+#define H2_MAX_FRAME_SIZE 16384         // 我方接收的最大帧（协议默认值）
+#define H2_HEADER_TABLE_SIZE 4096
+#define H2_MAX_HOSTS 32
+
+static const char h2_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// 可增长的字节缓冲区
+typedef struct H2Buf {
+	char* data;
+	size_t len;
+	size_t cap;
+} H2Buf;
+
+static int h2buf_append(H2Buf* buf, const void* data, size_t len) {
+	if (buf->len + len > buf->cap) {
+		size_t cap = buf->cap ? buf->cap * 2 : 256;
+		while (cap < buf->len + len) cap *= 2;
+		char* p = (char*)realloc(buf->data, cap);
+		if (p == NULL) return 0;
+		buf->data = p;
+		buf->cap = cap;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+	return 1;
+}
+
+static void h2buf_free(H2Buf* buf) {
+	free(buf->data);
+	buf->data = NULL;
+	buf->len = buf->cap = 0;
+}
+
+// ---------- HPACK ----------
+
+typedef struct HpackEntry {
+	char* name;
+	char* value;
+} HpackEntry;
+
+// 动态表，entries[0] 为最新加入的条目
+typedef struct HpackTable {
+	HpackEntry* entries;
+	int count;
+	int capacity;
+	size_t size;
+	size_t max_size;
+} HpackTable;
+
+static void hpack_table_evict(HpackTable* t, size_t limit) {
+	while (t->count > 0 && t->size > limit) {
+		HpackEntry* e = &t->entries[--t->count];
+		t->size -= strlen(e->name) + strlen(e->value) + 32;
+		free(e->name);
+		free(e->value);
+	}
+}
+
+static void hpack_table_set_max(HpackTable* t, size_t max_size) {
+	t->max_size = max_size;
+	hpack_table_evict(t, max_size);
+}
+
+static void hpack_table_add(HpackTable* t, const char* name, const char* value) {
+	size_t entry_size = strlen(name) + strlen(value) + 32;
+	if (entry_size > t->max_size) {
+		// 比整个表还大的条目会清空表
+		hpack_table_evict(t, 0);
+		return;
+	}
+	hpack_table_evict(t, t->max_size - entry_size);
+
+	if (t->count == t->capacity) {
+		int capacity = t->capacity ? t->capacity * 2 : 16;
+		HpackEntry* entries = (HpackEntry*)realloc(t->entries, capacity * sizeof(HpackEntry));
+		if (entries == NULL) return;
+		t->entries = entries;
+		t->capacity = capacity;
+	}
+
+	HpackEntry e;
+	e.name = _strdup(name);
+	e.value = _strdup(value);
+	if (e.name == NULL || e.value == NULL) {
+		free(e.name);
+		free(e.value);
+		return;
+	}
+	memmove(t->entries + 1, t->entries, t->count * sizeof(HpackEntry));
+	t->entries[0] = e;
+	t->count++;
+	t->size += entry_size;
+}
+
+static void hpack_table_free(HpackTable* t) {
+	hpack_table_evict(t, 0);
+	free(t->entries);
+	t->entries = NULL;
+	t->capacity = 0;
+}
+
+// 按索引取条目（1~61 为静态表，之后为动态表）
+static int hpack_table_get(const HpackTable* t, unsigned int index, const char** name, const char** value) {
+	if (index >= 1 && index <= 61) {
+		*name = hpack_static_table[index][0];
+		*value = hpack_static_table[index][1];
+		return 1;
+	}
+	if (index > 61 && index - 62 < (unsigned int)t->count) {
+		*name = t->entries[index - 62].name;
+		*value = t->entries[index - 62].value;
+		return 1;
+	}
+	return 0;
+}
+
+static int hpack_decode_int(const unsigned char** p, const unsigned char* end, int prefix_bits, unsigned int* out) {
+	if (*p >= end) return 0;
+
+	unsigned int max_prefix = (1u << prefix_bits) - 1;
+	unsigned int value = **p & max_prefix;
+	(*p)++;
+	if (value < max_prefix) {
+		*out = value;
+		return 1;
+	}
+
+	int shift = 0;
+	while (*p < end && shift <= 28) {
+		unsigned char b = **p;
+		(*p)++;
+		value += (unsigned int)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			*out = value;
+			return 1;
+		}
+		shift += 7;
+	}
+	return 0;
+}
+
+// 解码字符串（可能是 Huffman 编码），返回以 '\0' 结尾的新字符串
+static char* hpack_decode_string(const unsigned char** p, const unsigned char* end) {
+	if (*p >= end) return NULL;
+
+	int huffman = (**p & 0x80) != 0;
+	unsigned int len;
+	if (!hpack_decode_int(p, end, 7, &len) || (size_t)(end - *p) < len) return NULL;
+
+	const unsigned char* src = *p;
+	*p += len;
+
+	if (!huffman) {
+		char* str = (char*)malloc(len + 1);
+		if (str == NULL) return NULL;
+		memcpy(str, src, len);
+		str[len] = '\0';
+		return str;
+	}
+
+	// Huffman 最短码为 5 位
+	char* str = (char*)malloc((size_t)len * 8 / 5 + 1);
+	if (str == NULL) return NULL;
+
+	size_t out = 0;
+	int node = 0;
+	for (unsigned int i = 0; i < len; i++) {
+		for (int bit = 7; bit >= 0; bit--) {
+			int next = hpack_huffman_tree[node][(src[i] >> bit) & 1];
+			if (next < 0) {
+				if (next == -257) {
+					// 正文中出现 EOS 属于错误
+					free(str);
+					return NULL;
+				}
+				str[out++] = (char)(-next - 1);
+				node = 0;
+			}
+			else if (next == 0) {
+				free(str);
+				return NULL;
+			}
+			else {
+				node = next;
+			}
+		}
+	}
+	str[out] = '\0';
+	return str;
+}
+
+static int hpack_encode_int(H2Buf* out, unsigned int value, int prefix_bits, unsigned char flags) {
+	unsigned int max_prefix = (1u << prefix_bits) - 1;
+	unsigned char b;
+	if (value < max_prefix) {
+		b = (unsigned char)(flags | value);
+		return h2buf_append(out, &b, 1);
+	}
+
+	b = (unsigned char)(flags | max_prefix);
+	if (!h2buf_append(out, &b, 1)) return 0;
+	value -= max_prefix;
+	while (value >= 0x80) {
+		b = (unsigned char)((value & 0x7F) | 0x80);
+		if (!h2buf_append(out, &b, 1)) return 0;
+		value >>= 7;
+	}
+	b = (unsigned char)value;
+	return h2buf_append(out, &b, 1);
+}
+
+static int hpack_encode_string(H2Buf* out, const char* str) {
+	size_t len = strlen(str);
+	return hpack_encode_int(out, (unsigned int)len, 7, 0x00) && h2buf_append(out, str, len);
+}
+
+// 编码一个请求头。index_it 非 0 时加入动态表，后续请求相同的头只需一个字节
+static int hpack_encode_header(HpackTable* t, H2Buf* out, const char* name, const char* value, int index_it) {
+	unsigned int name_index = 0;
+	const char* n;
+	const char* v;
+
+	for (unsigned int i = 1; i < 62 + (unsigned int)t->count; i++) {
+		hpack_table_get(t, i, &n, &v);
+		if (strcmp(n, name) == 0) {
+			if (strcmp(v, value) == 0) {
+				return hpack_encode_int(out, i, 7, 0x80); // 完全匹配：索引表示
+			}
+			if (name_index == 0) name_index = i;
+		}
+	}
+
+	int ok = index_it ? hpack_encode_int(out, name_index, 6, 0x40) : hpack_encode_int(out, name_index, 4, 0x00);
+	if (ok && name_index == 0) ok = hpack_encode_string(out, name);
+	if (ok) ok = hpack_encode_string(out, value);
+	if (ok && index_it) hpack_table_add(t, name, value);
+	return ok;
+}
+
+// ---------- 连接与流 ----------
+
+typedef struct Http2Stream {
+	unsigned int id;
+	int status;
+	H2Buf headers;              // 转换后的 "name: value\r\n"
+	H2Buf body;
+	long long send_window;
+	int done;
+	int failed;
+	struct Http2Stream* next;
+} Http2Stream;
+
+typedef struct Http2Conn {
+	char hostname[256];
+	char port[16];
+	SOCKET sock;
+	volatile LONG refs;
+	SRWLOCK lock;               // 保护流列表、窗口和连接状态
+	SRWLOCK send_lock;          // 串行化写套接字；HPACK 编码也在此锁内，保证编码顺序与发送顺序一致
+	CONDITION_VARIABLE changed;
+	int dead;                   // 连接已断开或收到 GOAWAY，不再接受新请求
+	int listed;                 // 仍在 g_h2_conns 中
+	unsigned int next_stream_id;
+	unsigned int active_streams; // 已占用的并发流（包括正在等待发送 HEADERS 的）
+	unsigned int peer_max_streams;
+	long long send_window;
+	long long peer_initial_window;
+	unsigned int peer_max_frame;
+	HpackTable encoder;
+	long long pending_table_size; // 需要在下一个头块开头发送的动态表大小更新，-1 表示无
+	HpackTable decoder;         // 以下三项只由读取线程使用
+	H2Buf header_block;         // 正在累积的 HEADERS + CONTINUATION
+	int header_end_stream;
+	unsigned int continuation_stream;
+	Http2Stream* streams;
+	struct Http2Conn* next;
+} Http2Conn;
+
+static struct {
+	char hostname[256];
+	char port[16];
+} g_h2_hosts[H2_MAX_HOSTS];
+static int g_h2_host_count;
+static Http2Conn* g_h2_conns;
+static SRWLOCK g_h2_lock = SRWLOCK_INIT;
+
+static void h2_conn_release(Http2Conn* conn) {
+	if (InterlockedDecrement(&conn->refs) != 0) return;
+
+	http_disconnect(conn->sock);
+	hpack_table_free(&conn->encoder);
+	hpack_table_free(&conn->decoder);
+	h2buf_free(&conn->header_block);
+	free(conn);
+}
+
+// 发送一帧（调用者持有 send_lock）
+static int h2_send_frame(Http2Conn* conn, int type, int flags, unsigned int stream_id,
+	const void* payload, size_t len) {
+	unsigned char header[9];
+	header[0] = (unsigned char)(len >> 16);
+	header[1] = (unsigned char)(len >> 8);
+	header[2] = (unsigned char)len;
+	header[3] = (unsigned char)type;
+	header[4] = (unsigned char)flags;
+	header[5] = (unsigned char)((stream_id >> 24) & 0x7F);
+	header[6] = (unsigned char)(stream_id >> 16);
+	header[7] = (unsigned char)(stream_id >> 8);
+	header[8] = (unsigned char)stream_id;
+	return http_send_all(conn->sock, (const char*)header, 9) &&
+		(len == 0 || http_send_all(conn->sock, (const char*)payload, len));
+}
+
+static int h2_send_window_update(Http2Conn* conn, unsigned int stream_id, unsigned int increment) {
+	unsigned char payload[4];
+	payload[0] = (unsigned char)((increment >> 24) & 0x7F);
+	payload[1] = (unsigned char)(increment >> 16);
+	payload[2] = (unsigned char)(increment >> 8);
+	payload[3] = (unsigned char)increment;
+
+	AcquireSRWLockExclusive(&conn->send_lock);
+	int ok = h2_send_frame(conn, H2_FRAME_WINDOW_UPDATE, 0, stream_id, payload, 4);
+	ReleaseSRWLockExclusive(&conn->send_lock);
+	return ok;
+}
+
+static unsigned int h2_read_u32(const unsigned char* p) {
+	return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+static int h2_recv_exact(SOCKET sock, unsigned char* buf, size_t len) {
+	while (len > 0) {
+		int n = recv(sock, (char*)buf, (int)len, 0);
+		if (n <= 0) return 0;
+		buf += n;
+		len -= n;
+	}
+	return 1;
+}
+
+// 查找未完成的流（调用者持有 lock）
+static Http2Stream* h2_find_stream(Http2Conn* conn, unsigned int id) {
+	Http2Stream* stream = conn->streams;
+	while (stream != NULL && stream->id != id) stream = stream->next;
+	return stream != NULL && !stream->done ? stream : NULL;
+}
+
+// 解码完整的头块到 out（只使用 status 和 headers）。
+// 即使对应的流已不存在也必须解码，以保持动态表同步
+static int h2_decode_headers(Http2Conn* conn, Http2Stream* out, const unsigned char* p, size_t len) {
+	const unsigned char* end = p + len;
+
+	while (p < end) {
+		unsigned char b = *p;
+		const char* name = NULL;
+		const char* value = NULL;
+		char* name_copy = NULL;
+		char* value_copy = NULL;
+		unsigned int index;
+
+		if (b & 0x80) {
+			// 索引表示
+			if (!hpack_decode_int(&p, end, 7, &index) || !hpack_table_get(&conn->decoder, index, &name, &value)) {
+				return 0;
+			}
+		}
+		else if ((b & 0xE0) == 0x20) {
+			// 动态表大小更新
+			if (!hpack_decode_int(&p, end, 5, &index) || index > H2_HEADER_TABLE_SIZE) return 0;
+			hpack_table_set_max(&conn->decoder, index);
+			continue;
+		}
+		else {
+			// 字面量：0x40 加入动态表，0x00 / 0x10 不加入
+			int indexing = (b & 0xC0) == 0x40;
+			if (!hpack_decode_int(&p, end, indexing ? 6 : 4, &index)) return 0;
+			if (index != 0) {
+				const char* unused;
+				if (!hpack_table_get(&conn->decoder, index, &name, &unused)) return 0;
+				name_copy = _strdup(name);
+			}
+			else {
+				name_copy = hpack_decode_string(&p, end);
+			}
+			value_copy = hpack_decode_string(&p, end);
+			if (name_copy == NULL || value_copy == NULL) {
+				free(name_copy);
+				free(value_copy);
+				return 0;
+			}
+			if (indexing) hpack_table_add(&conn->decoder, name_copy, value_copy);
+			name = name_copy;
+			value = value_copy;
+		}
+
+		if (strcmp(name, ":status") == 0) {
+			out->status = atoi(value);
+		}
+		else if (name[0] != ':') {
+			h2buf_append(&out->headers, name, strlen(name));
+			h2buf_append(&out->headers, ": ", 2);
+			h2buf_append(&out->headers, value, strlen(value));
+			h2buf_append(&out->headers, "\r\n", 2);
+		}
+		free(name_copy);
+		free(value_copy);
+	}
+	return 1;
+}
+
+// 头块接收完整后解码，把结果交给对应的流，并在需要时结束流
+static int h2_headers_complete(Http2Conn* conn, unsigned int stream_id) {
+	Http2Stream decoded;
+	memset(&decoded, 0, sizeof(decoded));
+	int ok = h2_decode_headers(conn, &decoded, (const unsigned char*)conn->header_block.data,
+		conn->header_block.len);
+	conn->header_block.len = 0;
+	conn->continuation_stream = 0;
+
+	AcquireSRWLockExclusive(&conn->lock);
+	Http2Stream* stream = ok ? h2_find_stream(conn, stream_id) : NULL;
+	if (stream != NULL) {
+		// 第二个头块是尾部字段（trailers），没有 :status
+		if (decoded.status != 0) stream->status = decoded.status;
+		if (decoded.headers.len > 0) h2buf_append(&stream->headers, decoded.headers.data, decoded.headers.len);
+		if (conn->header_end_stream) {
+			stream->done = 1;
+			WakeAllConditionVariable(&conn->changed);
+		}
+	}
+	ReleaseSRWLockExclusive(&conn->lock);
+
+	h2buf_free(&decoded.headers);
+	return ok;
+}
+
+// 处理一帧，协议错误返回 0
+static int h2_handle_frame(Http2Conn* conn, int type, int flags, unsigned int stream_id,
+	const unsigned char* payload, size_t len) {
+	// 头块未结束时只允许同一流的 CONTINUATION
+	if (conn->continuation_stream != 0 &&
+		(type != H2_FRAME_CONTINUATION || stream_id != conn->continuation_stream)) {
+		return 0;
+	}
+
+	switch (type) {
+	case H2_FRAME_DATA:
+	case H2_FRAME_HEADERS: {
+		size_t pad = 0;
+		if (flags & H2_FLAG_PADDED) {
+			if (len < 1) return 0;
+			pad = payload[0];
+			payload++;
+			len--;
+		}
+		if (type == H2_FRAME_HEADERS && (flags & H2_FLAG_PRIORITY)) {
+			if (len < 5) return 0;
+			payload += 5;
+			len -= 5;
+		}
+		if (pad > len) return 0;
+		len -= pad;
+
+		if (type == H2_FRAME_DATA) {
+			AcquireSRWLockExclusive(&conn->lock);
+			Http2Stream* stream = h2_find_stream(conn, stream_id);
+			if (stream != NULL && stream->body.len < sizeof(response)) {
+				size_t keep = sizeof(response) - stream->body.len;
+				h2buf_append(&stream->body, payload, len < keep ? len : keep);
+			}
+			int stream_open = stream != NULL && !(flags & H2_FLAG_END_STREAM);
+			if (stream != NULL && (flags & H2_FLAG_END_STREAM)) {
+				stream->done = 1;
+				WakeAllConditionVariable(&conn->changed);
+			}
+			ReleaseSRWLockExclusive(&conn->lock);
+
+			// 数据已被消费，归还接收窗口（包括填充字节）
+			size_t consumed = len + pad + ((flags & H2_FLAG_PADDED) ? 1 : 0);
+			if (consumed > 0) {
+				h2_send_window_update(conn, 0, (unsigned int)consumed);
+				if (stream_open) h2_send_window_update(conn, stream_id, (unsigned int)consumed);
+			}
+			return 1;
+		}
+
+		// 头块先累积在连接上，END_HEADERS 后统一解码
+		conn->header_block.len = 0;
+		if (!h2buf_append(&conn->header_block, payload, len)) return 0;
+		conn->header_end_stream = (flags & H2_FLAG_END_STREAM) != 0;
+		conn->continuation_stream = stream_id;
+		return (flags & H2_FLAG_END_HEADERS) ? h2_headers_complete(conn, stream_id) : 1;
+	}
+
+	case H2_FRAME_CONTINUATION: {
+		if (conn->continuation_stream != stream_id) return 0;
+		if (!h2buf_append(&conn->header_block, payload, len)) return 0;
+		return (flags & H2_FLAG_END_HEADERS) ? h2_headers_complete(conn, stream_id) : 1;
+	}
+
+	case H2_FRAME_SETTINGS: {
+		if (flags & H2_FLAG_ACK) return 1;
+		if (len % 6 != 0) return 0;
+
+		for (size_t i = 0; i < len; i += 6) {
+			unsigned int id = ((unsigned int)payload[i] << 8) | payload[i + 1];
+			unsigned int value = h2_read_u32(payload + i + 2);
+			if (id == H2_SETTINGS_INITIAL_WINDOW_SIZE) {
+				if (value > 0x7FFFFFFF) return 0;
+				AcquireSRWLockExclusive(&conn->lock);
+				long long delta = (long long)value - conn->peer_initial_window;
+				conn->peer_initial_window = value;
+				for (Http2Stream* s = conn->streams; s != NULL; s = s->next) {
+					s->send_window += delta;
+				}
+				WakeAllConditionVariable(&conn->changed);
+				ReleaseSRWLockExclusive(&conn->lock);
+			}
+			else if (id == H2_SETTINGS_MAX_CONCURRENT_STREAMS) {
+				// 超出对方限制的新流会被拒绝，请求线程等待空闲名额
+				AcquireSRWLockExclusive(&conn->lock);
+				conn->peer_max_streams = value;
+				WakeAllConditionVariable(&conn->changed);
+				ReleaseSRWLockExclusive(&conn->lock);
+			}
+			else if (id == H2_SETTINGS_MAX_FRAME_SIZE) {
+				if (value < 16384 || value > 16777215) return 0;
+				AcquireSRWLockExclusive(&conn->lock);
+				conn->peer_max_frame = value;
+				ReleaseSRWLockExclusive(&conn->lock);
+			}
+			else if (id == H2_SETTINGS_HEADER_TABLE_SIZE) {
+				// 编码端动态表不超过对方允许的大小
+				AcquireSRWLockExclusive(&conn->send_lock);
+				conn->pending_table_size = value < H2_HEADER_TABLE_SIZE ? value : H2_HEADER_TABLE_SIZE;
+				ReleaseSRWLockExclusive(&conn->send_lock);
+			}
+		}
+
+		AcquireSRWLockExclusive(&conn->send_lock);
+		int ok = h2_send_frame(conn, H2_FRAME_SETTINGS, H2_FLAG_ACK, 0, NULL, 0);
+		ReleaseSRWLockExclusive(&conn->send_lock);
+		return ok;
+	}
+
+	case H2_FRAME_PING: {
+		if (len != 8) return 0;
+		if (flags & H2_FLAG_ACK) return 1;
+		AcquireSRWLockExclusive(&conn->send_lock);
+		int ok = h2_send_frame(conn, H2_FRAME_PING, H2_FLAG_ACK, 0, payload, 8);
+		ReleaseSRWLockExclusive(&conn->send_lock);
+		return ok;
+	}
+
+	case H2_FRAME_WINDOW_UPDATE: {
+		if (len != 4) return 0;
+		unsigned int increment = h2_read_u32(payload) & 0x7FFFFFFF;
+		AcquireSRWLockExclusive(&conn->lock);
+		if (stream_id == 0) {
+			conn->send_window += increment;
+		}
+		else {
+			Http2Stream* stream = h2_find_stream(conn, stream_id);
+			if (stream != NULL) stream->send_window += increment;
+		}
+		WakeAllConditionVariable(&conn->changed);
+		ReleaseSRWLockExclusive(&conn->lock);
+		return 1;
+	}
+
+	case H2_FRAME_RST_STREAM: {
+		AcquireSRWLockExclusive(&conn->lock);
+		Http2Stream* stream = h2_find_stream(conn, stream_id);
+		if (stream != NULL) {
+			stream->done = 1;
+			stream->failed = 1;
+			WakeAllConditionVariable(&conn->changed);
+		}
+		ReleaseSRWLockExclusive(&conn->lock);
+		return 1;
+	}
+
+	case H2_FRAME_GOAWAY: {
+		if (len < 8) return 0;
+		unsigned int last_stream = h2_read_u32(payload) & 0x7FFFFFFF;
+		// 编号更大的流不会被处理，立即失败；其余的流继续接收直到连接关闭
+		AcquireSRWLockExclusive(&conn->lock);
+		conn->dead = 1;
+		for (Http2Stream* s = conn->streams; s != NULL; s = s->next) {
+			if (s->id > last_stream && !s->done) {
+				s->done = 1;
+				s->failed = 1;
+			}
+		}
+		WakeAllConditionVariable(&conn->changed);
+		ReleaseSRWLockExclusive(&conn->lock);
+		return 1;
+	}
+
+	case H2_FRAME_PUSH_PROMISE:
+		return 0; // 已通过 SETTINGS 禁用推送
+
+	default:
+		return 1; // PRIORITY 及未知类型的帧忽略
+	}
+}
+
+// 从连接列表中移除（之后的请求会新建连接）
+static void h2_conn_unlist(Http2Conn* conn) {
+	AcquireSRWLockExclusive(&g_h2_lock);
+	int listed = conn->listed;
+	if (listed) {
+		Http2Conn** link = &g_h2_conns;
+		while (*link != conn) link = &(*link)->next;
+		*link = conn->next;
+		conn->listed = 0;
+	}
+	ReleaseSRWLockExclusive(&g_h2_lock);
+	if (listed) h2_conn_release(conn);
+}
+
+// 读取线程：接收所有帧并分发给对应的流
+static unsigned __stdcall h2_reader(void* arg) {
+	Http2Conn* conn = (Http2Conn*)arg;
+	unsigned char header[9];
+	unsigned char* payload = (unsigned char*)malloc(H2_MAX_FRAME_SIZE);
+
+	while (payload != NULL && h2_recv_exact(conn->sock, header, 9)) {
+		size_t len = ((size_t)header[0] << 16) | ((size_t)header[1] << 8) | header[2];
+		unsigned int stream_id = h2_read_u32(header + 5) & 0x7FFFFFFF;
+		if (len > H2_MAX_FRAME_SIZE || !h2_recv_exact(conn->sock, payload, len)) break;
+		if (!h2_handle_frame(conn, header[3], header[4], stream_id, payload, len)) break;
+	}
+	free(payload);
+
+	// 连接结束，所有未完成的流失败
+	AcquireSRWLockExclusive(&conn->lock);
+	conn->dead = 1;
+	for (Http2Stream* s = conn->streams; s != NULL; s = s->next) {
+		if (!s->done) {
+			s->done = 1;
+			s->failed = 1;
+		}
+	}
+	WakeAllConditionVariable(&conn->changed);
+	ReleaseSRWLockExclusive(&conn->lock);
+
+	h2_conn_unlist(conn);
+	h2_conn_release(conn);
+	return 0;
+}
+
+// 建立新的 h2c 连接：发送连接前言和 SETTINGS，启动读取线程
+static Http2Conn* h2_conn_open(const char* hostname, const char* port, const char** error) {
+	Http2Conn* conn = (Http2Conn*)calloc(1, sizeof(Http2Conn));
+	if (conn == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	conn->sock = http_connect(hostname, port, error);
+	if (conn->sock == INVALID_SOCKET) {
+		free(conn);
+		return NULL;
+	}
+
+	int nodelay = 1;
+	setsockopt(conn->sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+
+	safe_strcpy(conn->hostname, sizeof(conn->hostname), hostname, strlen(hostname));
+	safe_strcpy(conn->port, sizeof(conn->port), port, strlen(port));
+	InitializeSRWLock(&conn->lock);
+	InitializeSRWLock(&conn->send_lock);
+	InitializeConditionVariable(&conn->changed);
+	conn->next_stream_id = 1;
+	conn->peer_max_streams = 0xFFFFFFFF; // 对方未声明时不限制
+	conn->send_window = H2_DEFAULT_WINDOW;
+	conn->peer_initial_window = H2_DEFAULT_WINDOW;
+	conn->peer_max_frame = 16384;
+	conn->pending_table_size = -1;
+	conn->encoder.max_size = H2_HEADER_TABLE_SIZE;
+	conn->decoder.max_size = H2_HEADER_TABLE_SIZE;
+	conn->refs = 1;
+
+	// SETTINGS：禁用推送，扩大初始接收窗口；再把连接级接收窗口扩大到同样大小
+	unsigned char settings[12] = {
+		0, H2_SETTINGS_ENABLE_PUSH, 0, 0, 0, 0,
+		0, H2_SETTINGS_INITIAL_WINDOW_SIZE,
+		(unsigned char)(H2_LOCAL_WINDOW >> 24), (unsigned char)(H2_LOCAL_WINDOW >> 16),
+		(unsigned char)(H2_LOCAL_WINDOW >> 8), (unsigned char)H2_LOCAL_WINDOW
+	};
+	if (!http_send_all(conn->sock, h2_preface, sizeof(h2_preface) - 1) ||
+		!h2_send_frame(conn, H2_FRAME_SETTINGS, 0, 0, settings, sizeof(settings)) ||
+		!h2_send_window_update(conn, 0, H2_LOCAL_WINDOW - H2_DEFAULT_WINDOW)) {
+		h2_conn_release(conn);
+		*error = "send failed";
+		return NULL;
+	}
+
+	InterlockedIncrement(&conn->refs); // 读取线程持有
+	HANDLE reader = (HANDLE)_beginthreadex(NULL, 0, h2_reader, conn, 0, NULL);
+	if (reader == NULL) {
+		conn->refs = 1;
+		h2_conn_release(conn);
+		*error = "Unable to start HTTP/2 reader";
+		return NULL;
+	}
+	CloseHandle(reader);
+	return conn;
+}
+
+static int h2_conn_dead(Http2Conn* conn) {
+	AcquireSRWLockShared(&conn->lock);
+	int dead = conn->dead;
+	ReleaseSRWLockShared(&conn->lock);
+	return dead;
+}
+
+// 标记连接失效并关闭套接字，读取线程随后退出并让所有未完成的流失败
+static void h2_conn_abort(Http2Conn* conn) {
+	AcquireSRWLockExclusive(&conn->lock);
+	conn->dead = 1;
+	WakeAllConditionVariable(&conn->changed);
+	ReleaseSRWLockExclusive(&conn->lock);
+	shutdown(conn->sock, SD_BOTH);
+}
+
+// 在列表中查找到主机的可用连接并增加引用（调用者持有 g_h2_lock）
+static Http2Conn* h2_find_conn(const char* hostname, const char* port) {
+	for (Http2Conn* conn = g_h2_conns; conn != NULL; conn = conn->next) {
+		if (!h2_conn_dead(conn) && strcmp(conn->hostname, hostname) == 0 && strcmp(conn->port, port) == 0) {
+			InterlockedIncrement(&conn->refs);
+			return conn;
+		}
+	}
+	return NULL;
+}
+
+// 取得到主机的可用连接（增加引用），没有时新建。
+// 建立连接可能很慢，期间不持有 g_h2_lock，以免阻塞其他主机的请求
+static Http2Conn* h2_get_conn(const char* hostname, const char* port, const char** error) {
+	AcquireSRWLockShared(&g_h2_lock);
+	Http2Conn* conn = h2_find_conn(hostname, port);
+	ReleaseSRWLockShared(&g_h2_lock);
+	if (conn != NULL) return conn;
+
+	Http2Conn* created = h2_conn_open(hostname, port, error);
+	if (created == NULL) return NULL;
+
+	AcquireSRWLockExclusive(&g_h2_lock);
+	conn = h2_find_conn(hostname, port);
+	if (conn == NULL && !h2_conn_dead(created)) {
+		// 列表持有打开时的引用
+		conn = created;
+		conn->listed = 1;
+		conn->next = g_h2_conns;
+		g_h2_conns = conn;
+		InterlockedIncrement(&conn->refs);
+		created = NULL;
+	}
+	ReleaseSRWLockExclusive(&g_h2_lock);
+
+	if (created != NULL) {
+		// 其他线程已经建好连接，或新连接刚建立就断开了
+		h2_conn_abort(created);
+		h2_conn_release(created);
+		if (conn == NULL) *error = "HTTP/2 connection closed";
+	}
+	return conn;
+}
+
+static int http2_host_enabled(const char* hostname, const char* port) {
+	int enabled = 0;
+	AcquireSRWLockShared(&g_h2_lock);
+	for (int i = 0; i < g_h2_host_count && !enabled; i++) {
+		enabled = strcmp(g_h2_hosts[i].hostname, hostname) == 0 && strcmp(g_h2_hosts[i].port, port) == 0;
+	}
+	ReleaseSRWLockShared(&g_h2_lock);
+	return enabled;
+}
+
+// 把 "Name: value\r\n" 形式的附加请求头编码进头块（名称转为小写）
+static int h2_encode_extra_headers(Http2Conn* conn, H2Buf* block, const char* extra_headers) {
+	char name[128];
+	char value[1024];
+
+	while (extra_headers != NULL && *extra_headers) {
+		const char* line_end = strstr(extra_headers, "\r\n");
+		const char* colon = strchr(extra_headers, ':');
+		if (line_end == NULL) line_end = extra_headers + strlen(extra_headers);
+		if (colon != NULL && colon < line_end && (size_t)(colon - extra_headers) < sizeof(name)) {
+			size_t name_len = colon - extra_headers;
+			for (size_t i = 0; i < name_len; i++) {
+				name[i] = (char)tolower((unsigned char)extra_headers[i]);
+			}
+			name[name_len] = '\0';
+
+			const char* v = colon + 1;
+			while (*v == ' ' || *v == '\t') v++;
+			safe_strcpy(value, sizeof(value), v, line_end - v);
+			if (!hpack_encode_header(&conn->encoder, block, name, value, 1)) return 0;
+		}
+		extra_headers = *line_end ? line_end + 2 : line_end;
+	}
+	return 1;
+}
+
+// 通过 HTTP/2 发送请求，响应转换为 HTTP/1.1 形式写入 response
+static const char* http2_request(const char* hostname, const char* port, const char* path,
+	const char* method, const char* content_type, const char* data, const char* extra_headers) {
+	const char* error = "HTTP/2 request failed";
+	Http2Conn* conn = h2_get_conn(hostname, port, &error);
+	if (conn == NULL) {
+		return error;
+	}
+
+	Http2Stream* stream = (Http2Stream*)calloc(1, sizeof(Http2Stream));
+	if (stream == NULL) {
+		h2_conn_release(conn);
+		return "out of memory";
 	}
 
-	// 尝试每个返回的地址，直到成功连接
-	sock = INVALID_SOCKET;
-	for (ptr = result; ptr != NULL; ptr = ptr->ai_next) {
-		sock = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol);
-		if (sock == INVALID_SOCKET) {
-			continue;
-		}
+	size_t body_len = data != NULL && strcmp(method, "POST") == 0 ? strlen(data) : 0;
+	char authority[300];
+	char length[32];
+	snprintf(authority, sizeof(authority), "%s:%s", hostname, port);
+	snprintf(length, sizeof(length), "%u", (unsigned int)body_len);
+
+	// 先占用一个并发流名额。不能持有 send_lock 等待：读取线程发送 WINDOW_UPDATE 也需要它
+	int ok = 1;
+	AcquireSRWLockExclusive(&conn->lock);
+	while (!conn->dead && conn->active_streams >= conn->peer_max_streams) {
+		SleepConditionVariableSRW(&conn->changed, &conn->lock, INFINITE, 0);
+	}
+	if (conn->dead) {
+		ok = 0;
+	}
+	else {
+		conn->active_streams++;
+	}
+	ReleaseSRWLockExclusive(&conn->lock);
+	int reserved = ok;
 
-		if (connect(sock, ptr->ai_addr, (int)ptr->ai_addrlen) != SOCKET_ERROR) {
+	// 分配流编号、编码头块、发送 HEADERS 必须在同一把锁内完成，保证顺序一致
+	H2Buf block = { NULL, 0, 0 };
+	AcquireSRWLockExclusive(&conn->send_lock);
+
+	size_t max_frame = 0;
+	AcquireSRWLockExclusive(&conn->lock);
+	if (!ok || conn->dead) {
+		ok = 0;
+	}
+	else {
+		// 最大帧长度由读取线程在 lock 内更新
+		max_frame = conn->peer_max_frame;
+		stream->id = conn->next_stream_id;
+		conn->next_stream_id += 2;
+		stream->send_window = conn->peer_initial_window;
+		stream->next = conn->streams;
+		conn->streams = stream;
+	}
+	ReleaseSRWLockExclusive(&conn->lock);
+
+	if (ok && conn->pending_table_size >= 0) {
+		hpack_table_set_max(&conn->encoder, (size_t)conn->pending_table_size);
+		ok = hpack_encode_int(&block, (unsigned int)conn->pending_table_size, 5, 0x20);
+		conn->pending_table_size = -1;
+	}
+	if (ok) {
+		ok = hpack_encode_header(&conn->encoder, &block, ":method", method, 1) &&
+			hpack_encode_header(&conn->encoder, &block, ":scheme", "http", 1) &&
+			hpack_encode_header(&conn->encoder, &block, ":authority", authority, 1) &&
+			hpack_encode_header(&conn->encoder, &block, ":path", path, 0) &&
+			hpack_encode_header(&conn->encoder, &block, "user-agent", "C-HTTP-Client/1.0", 1);
+	}
+	if (ok && body_len > 0) {
+		ok = hpack_encode_header(&conn->encoder, &block, "content-type", content_type, 1) &&
+			hpack_encode_header(&conn->encoder, &block, "content-length", length, 0);
+	}
+	if (ok) {
+		ok = h2_encode_extra_headers(conn, &block, extra_headers);
+	}
+	if (ok) {
+		// 头块超过对方的最大帧时拆成 HEADERS + CONTINUATION
+		size_t offset = 0;
+		int type = H2_FRAME_HEADERS;
+		do {
+			size_t n = block.len - offset < max_frame ? block.len - offset : max_frame;
+			int flags = offset + n == block.len ? H2_FLAG_END_HEADERS : 0;
+			if (type == H2_FRAME_HEADERS && body_len == 0) flags |= H2_FLAG_END_STREAM;
+			ok = h2_send_frame(conn, type, flags, stream->id, block.data + offset, n);
+			offset += n;
+			type = H2_FRAME_CONTINUATION;
+		} while (ok && offset < block.len);
+	}
+	ReleaseSRWLockExclusive(&conn->send_lock);
+	h2buf_free(&block);
+
+	// 发送请求体，受连接级和流级窗口限制
+	size_t sent = 0;
+	while (ok && sent < body_len) {
+		AcquireSRWLockExclusive(&conn->lock);
+		while (!conn->dead && !stream->done && (conn->send_window <= 0 || stream->send_window <= 0)) {
+			SleepConditionVariableSRW(&conn->changed, &conn->lock, INFINITE, 0);
+		}
+		if (conn->dead || stream->done) {
+			ReleaseSRWLockExclusive(&conn->lock);
 			break;
 		}
+		long long n = (long long)(body_len - sent);
+		if (n > conn->send_window) n = conn->send_window;
+		if (n > stream->send_window) n = stream->send_window;
+		if (n > (long long)conn->peer_max_frame) n = conn->peer_max_frame;
+		conn->send_window -= n;
+		stream->send_window -= n;
+		ReleaseSRWLockExclusive(&conn->lock);
+
+		AcquireSRWLockExclusive(&conn->send_lock);
+		ok = h2_send_frame(conn, H2_FRAME_DATA, sent + n == body_len ? H2_FLAG_END_STREAM : 0,
+			stream->id, data + sent, (size_t)n);
+		ReleaseSRWLockExclusive(&conn->send_lock);
+		sent += (size_t)n;
+	}
 
-		closesocket(sock);
-		sock = INVALID_SOCKET;
+	// 流已登记但发送失败：套接字出错，或者编码端动态表已与对方不一致，整条连接都不能再用
+	if (!ok && stream->id != 0) {
+		h2_conn_abort(conn);
 	}
 
-	freeaddrinfo(result);
+	// 等待响应，然后在锁内把流从连接上摘下。读取线程只在持锁时访问流，摘下后即可释放
+	AcquireSRWLockExclusive(&conn->lock);
+	if (stream->id != 0) {
+		while (ok && !stream->done) {
+			SleepConditionVariableSRW(&conn->changed, &conn->lock, INFINITE, 0);
+		}
+		if (!stream->done) {
+			stream->done = 1;
+			stream->failed = 1;
+		}
+		Http2Stream** link = &conn->streams;
+		while (*link != stream) link = &(*link)->next;
+		*link = stream->next;
+	}
+	if (reserved) {
+		conn->active_streams--;
+		WakeAllConditionVariable(&conn->changed);
+	}
+	ReleaseSRWLockExclusive(&conn->lock);
 
-	if (sock == INVALID_SOCKET) {
-		WSACleanup();
-		return "Unable to connect to server";
+	const char* result;
+	if (!ok || stream->failed || stream->status == 0) {
+		result = "HTTP/2 request failed";
+	}
+	else {
+		int n = snprintf(response, sizeof(response), "HTTP/2 %d\r\n%.*s\r\n", stream->status,
+			(int)stream->headers.len, stream->headers.data ? stream->headers.data : "");
+		if (n < 0 || n >= (int)sizeof(response)) n = (int)sizeof(response) - 1;
+		size_t body = stream->body.len < sizeof(response) - 1 - n ? stream->body.len : sizeof(response) - 1 - n;
+		if (body > 0) memcpy(response + n, stream->body.data, body);
+		response[n + body] = '\0';
+		result = response;
 	}
 
-	// 构建请求
-	if (data != NULL && strcmp(method, "POST") == 0) {
-		// POST 请求
+	h2buf_free(&stream->headers);
+	h2buf_free(&stream->body);
+	free(stream);
+	h2_conn_release(conn);
+	return result;
+}
+
+// 登记 h2c 主机：之后对该主机的请求直接使用 HTTP/2（不经过 Upgrade 协商）
+int http2_enable_host(const char* hostname, const char* port) {
+	if (hostname == NULL || port == NULL) return 0;
+	if (http2_host_enabled(hostname, port)) return 1;
+
+	AcquireSRWLockExclusive(&g_h2_lock);
+	int ok = g_h2_host_count < H2_MAX_HOSTS;
+	if (ok) {
+		safe_strcpy(g_h2_hosts[g_h2_host_count].hostname, sizeof(g_h2_hosts[0].hostname), hostname, strlen(hostname));
+		safe_strcpy(g_h2_hosts[g_h2_host_count].port, sizeof(g_h2_hosts[0].port), port, strlen(port));
+		g_h2_host_count++;
+	}
+	ReleaseSRWLockExclusive(&g_h2_lock);
+	return ok;
+}
+
+// 取消所有 h2c 主机并关闭现有连接（进行中的请求会失败）
+void http2_reset(void) {
+	AcquireSRWLockExclusive(&g_h2_lock);
+	g_h2_host_count = 0;
+	for (Http2Conn* conn = g_h2_conns; conn != NULL; conn = conn->next) {
+		shutdown(conn->sock, SD_BOTH);
+	}
+	ReleaseSRWLockExclusive(&g_h2_lock);
+}
+
+// ==================== 分段并行下载 ====================
+// 先用 HEAD（或 Range: bytes=0-0 的 GET）探测资源大小和是否支持 Range，
+// 支持时把资源分成若干段，每段用单独的连接下载，直接写入目标文件或缓冲区的对应位置。
+// 失败的段从已下载的位置继续重试；不支持 Range 时退回单连接下载。
+
+#define HTTP_DOWNLOAD_DEFAULT_SEGMENTS 4
+#define HTTP_DOWNLOAD_MAX_SEGMENTS 16
+#define HTTP_DOWNLOAD_MIN_SEGMENT_SIZE (256 * 1024)
+#define HTTP_DOWNLOAD_BUFFER_SIZE (64 * 1024)
+
+typedef struct HttpDownload {
+	const char* hostname;
+	const char* port;
+	const char* path;
+	HANDLE file;            // 写入文件时使用
+	char* buffer;           // 写入内存时使用
+	size_t buffer_size;
+} HttpDownload;
+
+typedef struct HttpSegment {
+	const HttpDownload* download;
+	long long start;
+	long long end;          // 包含
+	long long received;
+	int retries;
+	int ok;
+} HttpSegment;
+
+// 把数据写到目标的 offset 处（按位置写入，多个线程可同时写不同区域）
+static int http_download_write(const HttpDownload* dl, unsigned long long offset, const char* data, size_t len) {
+	if (dl->buffer != NULL) {
+		if (offset + len > dl->buffer_size) return 0;
+		memcpy(dl->buffer + offset, data, len);
+		return 1;
+	}
+
+	while (len > 0) {
+		OVERLAPPED ov;
+		DWORD written = 0;
+		memset(&ov, 0, sizeof(ov));
+		ov.Offset = (DWORD)offset;
+		ov.OffsetHigh = (DWORD)(offset >> 32);
+		if (!WriteFile(dl->file, data, (DWORD)len, &written, &ov) || written == 0) {
+			return 0;
+		}
+		data += written;
+		len -= written;
+		offset += written;
+	}
+	return 1;
+}
+
+// 把目标文件的大小设为 size（写入缓冲区时不需要），失败返回 0
+static int http_download_set_size(const HttpDownload* dl, long long size) {
+	if (dl->file == NULL) return 1;
+
+	LARGE_INTEGER file_size;
+	file_size.QuadPart = size;
+	return SetFilePointerEx(dl->file, file_size, NULL, FILE_BEGIN) && SetEndOfFile(dl->file);
+}
+
+// 下载 [start, end]；end 为 -1 时不发送 Range，下载整个资源。
+// *received 返回本次写入的字节数，全部完成返回 1
+static int http_download_range(const HttpDownload* dl, long long start, long long end, long long* received) {
+	const char* error = NULL;
+	char request[2048];
+	char header[8192];
+	static __declspec(thread) char buffer[HTTP_DOWNLOAD_BUFFER_SIZE];
+	int header_len = 0;
+	long long expected = -1;
+
+	*received = 0;
+	InterlockedIncrement(&g_stat_requests);
+	SOCKET sock = http_connect(dl->hostname, dl->port, &error);
+	if (sock == INVALID_SOCKET) return 0;
+
+	if (end >= 0) {
 		snprintf(request, sizeof(request),
-			"%s %s HTTP/1.1\r\n"
+			"GET %s HTTP/1.1\r\n"
 			"Host: %s\r\n"
 			"User-Agent: C-HTTP-Client/1.0\r\n"
-			"Content-Type: %s\r\n"
-			"Content-Length: %d\r\n"
+			"Range: bytes=%lld-%lld\r\n"
 			"Connection: close\r\n"
-			"\r\n"
-			"%s",
-			method, path, hostname, content_type, (int)strlen(data), data);
+			"\r\n",
+			dl->path, dl->hostname, start, end);
 	}
 	else {
-		// GET 请求
+		// 整体下载使用 HTTP/1.0，服务器不会返回 chunked 编码，正文直接读到连接关闭
 		snprintf(request, sizeof(request),
-			"%s %s HTTP/1.1\r\n"
+			"GET %s HTTP/1.0\r\n"
 			"Host: %s\r\n"
 			"User-Agent: C-HTTP-Client/1.0\r\n"
-			"Connection: close\r\n"
 			"\r\n",
-			method, path, hostname);
+			dl->path, dl->hostname);
+	}
+	if (!http_send_all(sock, request, strlen(request))) {
+		http_disconnect(sock);
+		return 0;
 	}
 
-	// 发送请求
-	if (send(sock, request, strlen(request), 0) == SOCKET_ERROR) {
-		closesocket(sock);
-		WSACleanup();
-		return "send failed";
+	// 读取响应头
+	const char* body = NULL;
+	while (body == NULL) {
+		int n = recv(sock, header + header_len, (int)sizeof(header) - header_len - 1, 0);
+		if (n <= 0) {
+			http_disconnect(sock);
+			return 0;
+		}
+		header_len += n;
+		header[header_len] = '\0';
+		body = http_response_body(header);
+		if (body == NULL && header_len >= (int)sizeof(header) - 1) {
+			http_disconnect(sock);
+			return 0;
+		}
 	}
 
-	// 接收响应
-	while ((bytes_received = recv(sock, response + total_received,
-		sizeof(response) - total_received - 1, 0)) > 0) {
-		total_received += bytes_received;
-		if (total_received >= sizeof(response) - 1) {
+	int status = http_status_code(header);
+	char value[128];
+	if (end >= 0) {
+		// 必须是从 start 开始的 206 响应
+		if (status != 206 || !http_find_header(header, "Content-Range", value, sizeof(value)) ||
+			strncmp(value, "bytes ", 6) != 0 || _atoi64(value + 6) != start) {
+			http_disconnect(sock);
+			return 0;
+		}
+		expected = end - start + 1;
+	}
+	else {
+		if (status != 200) {
+			http_disconnect(sock);
+			return 0;
+		}
+		if (http_find_header(header, "Content-Length", value, sizeof(value))) {
+			expected = _atoi64(value);
+		}
+	}
+
+	// 响应头之后已经收到的正文
+	size_t pending = header + header_len - body;
+	if (expected >= 0 && (long long)pending > expected) pending = (size_t)expected;
+	if (pending > 0) {
+		if (!http_download_write(dl, start, body, pending)) {
+			http_disconnect(sock);
+			return 0;
+		}
+		*received = pending;
+	}
+
+	while (expected < 0 || *received < expected) {
+		int n = recv(sock, buffer, sizeof(buffer), 0);
+		if (n < 0) break;
+		if (n == 0) {
+			// 连接关闭：长度未知时即为下载完成
+			if (expected < 0) expected = *received;
 			break;
 		}
+		if (expected >= 0 && *received + n > expected) n = (int)(expected - *received);
+		if (!http_download_write(dl, start + *received, buffer, n)) break;
+		*received += n;
 	}
 
-	response[total_received] = '\0';
+	http_disconnect(sock);
+	return expected >= 0 && *received == expected;
+}
 
-	closesocket(sock);
-	WSACleanup();
+static unsigned __stdcall http_segment_worker(void* arg) {
+	HttpSegment* seg = (HttpSegment*)arg;
+	int attempts = 0;
+
+	while (!seg->ok && attempts++ <= seg->retries) {
+		long long got = 0;
+		seg->ok = http_download_range(seg->download, seg->start + seg->received, seg->end, &got);
+		seg->received += got;
+		if (seg->start + seg->received > seg->end) seg->ok = 1;
+	}
+	return 0;
+}
+
+// 探测资源大小，*ranges 返回是否支持 Range。大小未知返回 -1
+static long long http_download_probe(const HttpDownload* dl, int* ranges) {
+	char value[128];
+	long long size = -1;
+	*ranges = 0;
+
+	const char* resp = http_request(dl->hostname, dl->port, dl->path, "HEAD", NULL, NULL, NULL);
+	if (http_status_code(resp) == 200) {
+		if (http_find_header(resp, "Content-Length", value, sizeof(value))) {
+			size = _atoi64(value);
+		}
+		if (http_find_header(resp, "Accept-Ranges", value, sizeof(value)) && strstr(value, "bytes") != NULL) {
+			*ranges = 1;
+		}
+	}
+	if (size >= 0 && *ranges) return size;
+
+	// HEAD 不可用或信息不全，请求第一个字节，从 Content-Range 中得到总大小
+	resp = http_request(dl->hostname, dl->port, dl->path, "GET", NULL, NULL, "Range: bytes=0-0\r\n");
+	if (http_status_code(resp) == 206 && http_find_header(resp, "Content-Range", value, sizeof(value))) {
+		const char* total = strchr(value, '/');
+		if (total != NULL && total[1] != '*') {
+			*ranges = 1;
+			return _atoi64(total + 1);
+		}
+	}
+	return size;
+}
+
+static long long http_download_run(HttpDownload* dl, const HttpDownloadOptions* options) {
+	int segments = options && options->segments > 0 ? options->segments : HTTP_DOWNLOAD_DEFAULT_SEGMENTS;
+	int retries = options ? options->retries : 2;
+	int ranges = 0;
+	long long size = http_download_probe(dl, &ranges);
+
+	if (segments > HTTP_DOWNLOAD_MAX_SEGMENTS) segments = HTTP_DOWNLOAD_MAX_SEGMENTS;
+	if (size > 0 && size / segments < HTTP_DOWNLOAD_MIN_SEGMENT_SIZE) {
+		segments = (int)(size / HTTP_DOWNLOAD_MIN_SEGMENT_SIZE);
+	}
+
+	if (dl->buffer != NULL && size > (long long)dl->buffer_size) return -1;
+
+	if (!ranges || size <= 0 || segments <= 1) {
+		// 单连接下载，无法续传，失败时清空文件从头重试
+		for (int attempt = 0; attempt <= retries; attempt++) {
+			long long got = 0;
+			if (attempt > 0 && !http_download_set_size(dl, 0)) return -1;
+			if (http_download_range(dl, 0, -1, &got) && (size < 0 || got == size)) {
+				return got;
+			}
+		}
+		return -1;
+	}
+
+	// 预先设置文件大小，避免各段写入时反复扩展文件
+	if (!http_download_set_size(dl, size)) return -1;
+
+	HttpSegment segs[HTTP_DOWNLOAD_MAX_SEGMENTS];
+	HANDLE threads[HTTP_DOWNLOAD_MAX_SEGMENTS];
+	long long segment_size = size / segments;
+	for (int i = 0; i < segments; i++) {
+		segs[i].download = dl;
+		segs[i].start = i * segment_size;
+		segs[i].end = i == segments - 1 ? size - 1 : (i + 1) * segment_size - 1;
+		segs[i].received = 0;
+		segs[i].retries = retries;
+		segs[i].ok = 0;
+		threads[i] = (HANDLE)_beginthreadex(NULL, 0, http_segment_worker, &segs[i], 0, NULL);
+		if (threads[i] == NULL) {
+			http_segment_worker(&segs[i]);
+		}
+	}
+
+	long long total = 0;
+	int ok = 1;
+	for (int i = 0; i < segments; i++) {
+		if (threads[i] != NULL) {
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+		ok = ok && segs[i].ok;
+		total += segs[i].received;
+	}
+	return ok ? total : -1;
+}
+
+// 下载到文件（覆盖已有文件），返回下载的字节数，失败返回 -1
+long long http_download_file(const char* hostname, const char* port, const char* path,
+	const char* dest_path, const HttpDownloadOptions* options) {
+	// h2c 主机不支持分段下载，在创建文件之前失败，不覆盖已有文件
+	if (http2_host_enabled(hostname, port)) return -1;
+
+	HttpDownload dl;
+	memset(&dl, 0, sizeof(dl));
+	dl.hostname = hostname;
+	dl.port = port;
+	dl.path = path;
+	dl.file = CreateFileA(dest_path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	if (dl.file == INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+
+	long long result = http_download_run(&dl, options);
+	CloseHandle(dl.file);
+	return result;
+}
+
+// 下载到调用者提供的缓冲区，返回下载的字节数；失败或缓冲区不足返回 -1
+long long http_download_buffer(const char* hostname, const char* port, const char* path,
+	char* buffer, size_t buffer_size, const HttpDownloadOptions* options) {
+	if (buffer == NULL || http2_host_enabled(hostname, port)) return -1;
+
+	HttpDownload dl;
+	memset(&dl, 0, sizeof(dl));
+	dl.hostname = hostname;
+	dl.port = port;
+	dl.path = path;
+	dl.buffer = buffer;
+	dl.buffer_size = buffer_size;
+	return http_download_run(&dl, options);
+}
+
+// ==================== 请求合并（single-flight） ====================
+// 相同的并发 GET 请求只发送一次，所有调用者共享同一个只读的引用计数缓冲区。
+
+struct HttpBuffer {
+	volatile LONG refs;
+	size_t length;
+	char data[1];           // 以 '\0' 结尾
+};
+
+typedef struct HttpFlight {
+	char* key;
+	int done;
+	int waiters;            // 正在等待结果的调用者数量
+	HttpBuffer* result;     // 完成后持有一个引用，最后一个等待者释放
+	struct HttpFlight* next;
+} HttpFlight;
+
+static HttpFlight* g_http_flights;
+static SRWLOCK g_http_flight_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE g_http_flight_done = CONDITION_VARIABLE_INIT;
+
+static HttpBuffer* http_buffer_create(const char* data, size_t length) {
+	HttpBuffer* buffer = (HttpBuffer*)malloc(sizeof(HttpBuffer) + length);
+	if (buffer == NULL) return NULL;
+
+	buffer->refs = 1;
+	buffer->length = length;
+	memcpy(buffer->data, data, length);
+	buffer->data[length] = '\0';
+	return buffer;
+}
 
+// 增加引用
+HttpBuffer* http_buffer_retain(HttpBuffer* buffer) {
+	if (buffer != NULL) InterlockedIncrement(&buffer->refs);
+	return buffer;
+}
+
+// 释放引用，计数归零时释放内存
+void http_buffer_release(HttpBuffer* buffer) {
+	if (buffer != NULL && InterlockedDecrement(&buffer->refs) == 0) {
+		free(buffer);
+	}
+}
+
+const char* http_buffer_data(const HttpBuffer* buffer) {
+	return buffer ? buffer->data : NULL;
+}
+
+size_t http_buffer_length(const HttpBuffer* buffer) {
+	return buffer ? buffer->length : 0;
+}
+
+// 等待者和发起者都离开后释放 flight（调用者持有锁）
+static void http_flight_finish(HttpFlight* flight) {
+	if (flight->done && flight->waiters == 0) {
+		http_buffer_release(flight->result);
+		free(flight->key);
+		free(flight);
+	}
+}
+
+// 发送 GET 请求；已有相同请求进行中时直接等待其结果。返回的缓冲区需调用 http_buffer_release
+static HttpBuffer* http_flight_fetch(const char* hostname, const char* port, const char* path,
+	const char* extra_headers) {
+	size_t key_size = strlen(hostname) + strlen(port) + strlen(path) +
+		(extra_headers ? strlen(extra_headers) : 0) + 8;
+	char* key = (char*)malloc(key_size);
+	if (key == NULL) return NULL;
+	snprintf(key, key_size, "GET %s:%s%s\n%s", hostname, port, path, extra_headers ? extra_headers : "");
+
+	AcquireSRWLockExclusive(&g_http_flight_lock);
+	HttpFlight* flight = g_http_flights;
+	while (flight != NULL && strcmp(flight->key, key) != 0) {
+		flight = flight->next;
+	}
+
+	if (flight != NULL) {
+		// 附加到进行中的请求
+		free(key);
+		InterlockedIncrement(&g_stat_coalesced);
+		flight->waiters++;
+		while (!flight->done) {
+			SleepConditionVariableSRW(&g_http_flight_done, &g_http_flight_lock, INFINITE, 0);
+		}
+		HttpBuffer* result = http_buffer_retain(flight->result);
+		flight->waiters--;
+		http_flight_finish(flight);
+		ReleaseSRWLockExclusive(&g_http_flight_lock);
+		return result;
+	}
+
+	flight = (HttpFlight*)calloc(1, sizeof(HttpFlight));
+	if (flight == NULL) {
+		ReleaseSRWLockExclusive(&g_http_flight_lock);
+		free(key);
+		return NULL;
+	}
+	flight->key = key;
+	flight->next = g_http_flights;
+	g_http_flights = flight;
+	ReleaseSRWLockExclusive(&g_http_flight_lock);
+
+	const char* resp = http_request(hostname, port, path, "GET", NULL, NULL, extra_headers);
+	HttpBuffer* result = http_buffer_create(resp, strlen(resp));
+
+	AcquireSRWLockExclusive(&g_http_flight_lock);
+	HttpFlight** link = &g_http_flights;
+	while (*link != flight) link = &(*link)->next;
+	*link = flight->next;
+
+	flight->result = http_buffer_retain(result);
+	flight->done = 1;
+	WakeAllConditionVariable(&g_http_flight_done);
+	http_flight_finish(flight);
+	ReleaseSRWLockExclusive(&g_http_flight_lock);
+	return result;
+}
+
+// 合并后的 GET 请求，结果复制到当前线程的响应缓冲区
+static const char* http_coalesced_get(const char* hostname, const char* port, const char* path,
+	const char* extra_headers) {
+	HttpBuffer* buffer = http_flight_fetch(hostname, port, path, extra_headers);
+	if (buffer == NULL) {
+		return http_request(hostname, port, path, "GET", NULL, NULL, extra_headers);
+	}
+
+	size_t length = buffer->length < sizeof(response) - 1 ? buffer->length : sizeof(response) - 1;
+	memcpy(response, buffer->data, length);
+	response[length] = '\0';
+	http_buffer_release(buffer);
 	return response;
 }
 
+// 获取运行统计
+void http_get_stats(HttpStats* stats) {
+	if (stats == NULL) return;
+
+	stats->requests = g_stat_requests;
+	stats->coalesced = g_stat_coalesced;
+	stats->cache_hits = g_stat_cache_hits;
+	stats->cache_revalidated = g_stat_cache_revalidated;
+}
+
+// ==================== HTTP 响应缓存 ====================
+// 按 方法+主机+端口+路径 缓存 200 响应，LRU 淘汰，容量按字节计算。
+// 过期后使用 If-None-Match / If-Modified-Since 重新验证，304 时直接返回缓存内容。
+
+#define HTTP_CACHE_BUCKETS 256
+
+// 缓存的解析结果带引用计数：缓存项被淘汰后，已交给调用方的对象仍然有效
+typedef struct HttpCachedJson {
+	volatile LONG refs;
+	JsonObject obj;
+} HttpCachedJson;
+
+typedef struct HttpCacheEntry {
+	char* key;
+	char* data;                 // 完整的原始响应（状态行 + 响应头 + 正文）
+	size_t length;
+	char etag[256];
+	char last_modified[64];
+	ULONGLONG expires_at;       // GetTickCount64 时间，之后需要重新验证
+	HttpCachedJson* json;       // 可选：已解析的正文
+	size_t charge;              // 计入容量的字节数
+	struct HttpCacheEntry* hash_next;
+	struct HttpCacheEntry* lru_prev;
+	struct HttpCacheEntry* lru_next;
+} HttpCacheEntry;
+
+static struct {
+	int enabled;
+	int keep_json;
+	size_t max_bytes;
+	size_t used_bytes;
+	HttpCacheEntry* buckets[HTTP_CACHE_BUCKETS];
+	HttpCacheEntry* lru_head;   // 最近使用
+	HttpCacheEntry* lru_tail;   // 最久未使用
+} g_http_cache;
+
+static SRWLOCK g_http_cache_lock = SRWLOCK_INIT;
+
+// 响应未进入缓存时 http_get_json 使用的对象
+static __declspec(thread) JsonObject g_http_json_scratch;
+// 本线程上一次 http_get_json 取得的缓存对象引用
+static __declspec(thread) HttpCachedJson* g_http_json_held;
+
+static void http_cached_json_release(HttpCachedJson* json) {
+	if (json != NULL && InterlockedDecrement(&json->refs) == 0) {
+		release_json_children(&json->obj);
+		free(json);
+	}
+}
+
+static unsigned int http_cache_hash(const char* key) {
+	unsigned int h = 2166136261u;
+	while (*key) {
+		h ^= (unsigned char)*key++;
+		h *= 16777619u;
+	}
+	return h % HTTP_CACHE_BUCKETS;
+}
+
+static void http_cache_lru_unlink(HttpCacheEntry* entry) {
+	if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+	else g_http_cache.lru_head = entry->lru_next;
+	if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+	else g_http_cache.lru_tail = entry->lru_prev;
+	entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void http_cache_lru_push_front(HttpCacheEntry* entry) {
+	entry->lru_prev = NULL;
+	entry->lru_next = g_http_cache.lru_head;
+	if (g_http_cache.lru_head) g_http_cache.lru_head->lru_prev = entry;
+	g_http_cache.lru_head = entry;
+	if (g_http_cache.lru_tail == NULL) g_http_cache.lru_tail = entry;
+}
+
+// 查找缓存项并标记为最近使用（调用者持有锁）
+static HttpCacheEntry* http_cache_lookup(const char* key) {
+	HttpCacheEntry* entry = g_http_cache.buckets[http_cache_hash(key)];
+	while (entry != NULL && strcmp(entry->key, key) != 0) {
+		entry = entry->hash_next;
+	}
+	if (entry != NULL && entry != g_http_cache.lru_head) {
+		http_cache_lru_unlink(entry);
+		http_cache_lru_push_front(entry);
+	}
+	return entry;
+}
+
+static void http_cache_free_entry(HttpCacheEntry* entry) {
+	http_cached_json_release(entry->json);
+	free(entry->key);
+	free(entry->data);
+	free(entry);
+}
+
+// 从缓存中移除并释放（调用者持有锁）
+static void http_cache_remove(HttpCacheEntry* entry) {
+	HttpCacheEntry** link = &g_http_cache.buckets[http_cache_hash(entry->key)];
+	while (*link != entry) link = &(*link)->hash_next;
+	*link = entry->hash_next;
+
+	http_cache_lru_unlink(entry);
+	g_http_cache.used_bytes -= entry->charge;
+	http_cache_free_entry(entry);
+}
+
+// 解析 Cache-Control，返回 max-age 秒数；no-store 返回 -1，未指定返回 0
+static long http_cache_max_age(const char* resp) {
+	char cache_control[256];
+	if (!http_find_header(resp, "Cache-Control", cache_control, sizeof(cache_control))) {
+		return 0;
+	}
+	if (strstr(cache_control, "no-store") != NULL) return -1;
+	if (strstr(cache_control, "no-cache") != NULL) return 0;
+
+	const char* max_age = strstr(cache_control, "max-age=");
+	if (max_age == NULL) return 0;
+	long seconds = atol(max_age + 8);
+	return seconds > 0 ? seconds : 0;
+}
+
+// 解析响应正文为 JSON（引用计数为 1），失败返回 NULL
+static HttpCachedJson* http_cache_parse_body(const char* resp) {
+	const char* body = http_response_body(resp);
+	if (body == NULL) return NULL;
+
+	HttpCachedJson* json = (HttpCachedJson*)malloc(sizeof(HttpCachedJson));
+	if (json == NULL) return NULL;
+
+	json->refs = 1;
+	clear_json_object(&json->obj);
+	if (!parse_json(skip_whitespace(body), &json->obj)) {
+		release_json_children(&json->obj);
+		free(json);
+		return NULL;
+	}
+	return json;
+}
+
+// 解析结果占用的内存：根对象加上所有嵌套的对象和数组
+static size_t http_cache_json_size(const JsonObject* obj) {
+	size_t size = 0;
+	for (int i = 0; i < obj->count; i++) {
+		if (obj->values[i].type == JSON_OBJECT && obj->values[i].object_value != NULL) {
+			size += sizeof(JsonObject) + http_cache_json_size(obj->values[i].object_value);
+		}
+		else if (obj->values[i].type == JSON_ARRAY && obj->values[i].array_value != NULL) {
+			const JsonArray* array = obj->values[i].array_value;
+			size += sizeof(JsonArray);
+			for (int j = 0; j < array->count; j++) {
+				if (array->element_types[j] == JSON_OBJECT && array->object_values[j] != NULL) {
+					size += sizeof(JsonObject) + http_cache_json_size(array->object_values[j]);
+				}
+			}
+		}
+	}
+	return size;
+}
+
+// 按 LRU 顺序淘汰，直到容量足够；keep 不会被淘汰（调用者持有锁）
+static void http_cache_trim(size_t extra, const HttpCacheEntry* keep) {
+	while (g_http_cache.lru_tail != NULL && g_http_cache.lru_tail != keep &&
+		g_http_cache.used_bytes + extra > g_http_cache.max_bytes) {
+		http_cache_remove(g_http_cache.lru_tail);
+	}
+}
+
+// 取得缓存项的解析结果并增加引用（调用者持有锁）。
+// 只有 keep_json 开启时才在缓存中保留解析结果，否则返回 NULL，由调用者自行解析
+static HttpCachedJson* http_cache_take_json(HttpCacheEntry* entry) {
+	if (entry->json == NULL) {
+		if (!g_http_cache.keep_json) return NULL;
+		entry->json = http_cache_parse_body(entry->data);
+		if (entry->json == NULL) return NULL;
+		size_t json_size = sizeof(HttpCachedJson) + http_cache_json_size(&entry->json->obj);
+		entry->charge += json_size;
+		g_http_cache.used_bytes += json_size;
+		http_cache_trim(0, entry);
+	}
+	InterlockedIncrement(&entry->json->refs);
+	return entry->json;
+}
+
+// 把 200 响应存入缓存（调用者持有锁），返回新缓存项
+static HttpCacheEntry* http_cache_store(const char* key, const char* resp) {
+	long max_age = http_cache_max_age(resp);
+	if (max_age < 0) return NULL;
+
+	HttpCacheEntry* old = http_cache_lookup(key);
+	if (old != NULL) {
+		http_cache_remove(old);
+	}
+
+	HttpCacheEntry* entry = (HttpCacheEntry*)calloc(1, sizeof(HttpCacheEntry));
+	if (entry == NULL) return NULL;
+
+	entry->length = strlen(resp);
+	entry->key = _strdup(key);
+	entry->data = (char*)malloc(entry->length + 1);
+	if (entry->key == NULL || entry->data == NULL) {
+		http_cache_free_entry(entry);
+		return NULL;
+	}
+	memcpy(entry->data, resp, entry->length + 1);
+
+	http_find_header(resp, "ETag", entry->etag, sizeof(entry->etag));
+	http_find_header(resp, "Last-Modified", entry->last_modified, sizeof(entry->last_modified));
+	entry->expires_at = GetTickCount64() + (ULONGLONG)max_age * 1000;
+
+	// 没有有效期也没有验证器的响应无法复用
+	if (max_age == 0 && entry->etag[0] == '\0' && entry->last_modified[0] == '\0') {
+		http_cache_free_entry(entry);
+		return NULL;
+	}
+
+	if (g_http_cache.keep_json) {
+		entry->json = http_cache_parse_body(resp);
+	}
+
+	entry->charge = sizeof(HttpCacheEntry) + strlen(key) + 1 + entry->length + 1;
+	if (entry->json != NULL) {
+		entry->charge += sizeof(HttpCachedJson) + http_cache_json_size(&entry->json->obj);
+	}
+	if (entry->charge > g_http_cache.max_bytes) {
+		http_cache_free_entry(entry);
+		return NULL;
+	}
+
+	http_cache_trim(entry->charge, NULL);
+
+	unsigned int bucket = http_cache_hash(key);
+	entry->hash_next = g_http_cache.buckets[bucket];
+	g_http_cache.buckets[bucket] = entry;
+	http_cache_lru_push_front(entry);
+	g_http_cache.used_bytes += entry->charge;
+	return entry;
+}
+
+// 经过缓存的 GET 请求；json_out 不为 NULL 时同时返回缓存的解析结果（已增加引用，
+// 用完后调用 http_cached_json_release）。响应没有进入缓存或未开启 keep_json 时 *json_out 保持不变
+static const char* http_cached_get(const char* hostname, const char* port, const char* path,
+	HttpCachedJson** json_out) {
+	char key[1536];
+	char conditional[512];
+	int key_len = snprintf(key, sizeof(key), "GET %s:%s%s", hostname, port, path);
+	if (key_len < 0 || key_len >= (int)sizeof(key)) {
+		return http_request(hostname, port, path, "GET", NULL, NULL, NULL);
+	}
+
+	conditional[0] = '\0';
+	AcquireSRWLockExclusive(&g_http_cache_lock);
+	HttpCacheEntry* entry = http_cache_lookup(key);
+	if (entry != NULL) {
+		if (GetTickCount64() < entry->expires_at) {
+			// 新鲜命中，不访问网络
+			InterlockedIncrement(&g_stat_cache_hits);
+			memcpy(response, entry->data, entry->length + 1);
+			if (json_out) *json_out = http_cache_take_json(entry);
+			ReleaseSRWLockExclusive(&g_http_cache_lock);
+			return response;
+		}
+
+		// 需要重新验证
+		int len = 0;
+		if (entry->etag[0] != '\0') {
+			len = snprintf(conditional, sizeof(conditional), "If-None-Match: %s\r\n", entry->etag);
+		}
+		if (entry->last_modified[0] != '\0' && len >= 0 && len < (int)sizeof(conditional)) {
+			snprintf(conditional + len, sizeof(conditional) - len,
+				"If-Modified-Since: %s\r\n", entry->last_modified);
+		}
+	}
+	ReleaseSRWLockExclusive(&g_http_cache_lock);
+
+	const char* resp = http_coalesced_get(hostname, port, path,
+		conditional[0] ? conditional : NULL);
+	int status = http_status_code(resp);
+
+	AcquireSRWLockExclusive(&g_http_cache_lock);
+	if (status == 304) {
+		entry = http_cache_lookup(key);
+		if (entry == NULL) {
+			// 等待期间缓存项已被淘汰，改为普通请求
+			ReleaseSRWLockExclusive(&g_http_cache_lock);
+			resp = http_coalesced_get(hostname, port, path, NULL);
+			AcquireSRWLockExclusive(&g_http_cache_lock);
+			status = http_status_code(resp);
+		}
+		else {
+			// 服务器确认内容未变：刷新有效期，返回缓存的正文
+			InterlockedIncrement(&g_stat_cache_revalidated);
+			long max_age = http_cache_max_age(resp);
+			entry->expires_at = GetTickCount64() + (ULONGLONG)(max_age > 0 ? max_age : 0) * 1000;
+			http_find_header(resp, "ETag", entry->etag, sizeof(entry->etag));
+			memcpy(response, entry->data, entry->length + 1);
+			if (json_out) *json_out = http_cache_take_json(entry);
+			ReleaseSRWLockExclusive(&g_http_cache_lock);
+			return response;
+		}
+	}
+
+	if (status == 200) {
+		entry = http_cache_store(key, resp);
+		if (json_out && entry != NULL) *json_out = http_cache_take_json(entry);
+	}
+	ReleaseSRWLockExclusive(&g_http_cache_lock);
+	return resp;
+}
+
+// 启用响应缓存，max_bytes 为容量上限；keep_json 非 0 时同时缓存解析后的 JSON
+// （解析结果按实际占用计入容量）
+void http_cache_enable(size_t max_bytes, int keep_json) {
+	AcquireSRWLockExclusive(&g_http_cache_lock);
+	g_http_cache.enabled = 1;
+	g_http_cache.keep_json = keep_json;
+	g_http_cache.max_bytes = max_bytes;
+	while (g_http_cache.lru_tail != NULL && g_http_cache.used_bytes > max_bytes) {
+		http_cache_remove(g_http_cache.lru_tail);
+	}
+	ReleaseSRWLockExclusive(&g_http_cache_lock);
+}
+
+// 清空缓存
+void http_cache_clear(void) {
+	AcquireSRWLockExclusive(&g_http_cache_lock);
+	while (g_http_cache.lru_tail != NULL) {
+		http_cache_remove(g_http_cache.lru_tail);
+	}
+	ReleaseSRWLockExclusive(&g_http_cache_lock);
+}
+
+// 关闭缓存并释放所有缓存项
+void http_cache_disable(void) {
+	http_cache_clear();
+	AcquireSRWLockExclusive(&g_http_cache_lock);
+	g_http_cache.enabled = 0;
+	ReleaseSRWLockExclusive(&g_http_cache_lock);
+}
+
 // 简单的 HTTP GET 实现
 const char* http_get(const char* hostname, const char* port, const char* path) {
-	return http_request(hostname, port, path, "GET", NULL, NULL);
+	if (g_http_cache.enabled) {
+		return http_cached_get(hostname, port, path, NULL);
+	}
+	return http_coalesced_get(hostname, port, path, NULL);
+}
+
+// GET 请求，返回共享的只读响应缓冲区；相同的并发请求只会发送一次。
+// 用完后调用 http_buffer_release()，失败返回 NULL
+HttpBuffer* http_get_shared(const char* hostname, const char* port, const char* path) {
+	if (g_http_cache.enabled) {
+		const char* resp = http_cached_get(hostname, port, path, NULL);
+		return http_buffer_create(resp, strlen(resp));
+	}
+	return http_flight_fetch(hostname, port, path, NULL);
+}
+
+// GET 请求并解析 JSON 正文。返回的对象在本线程下一次调用 http_get_json() 之前有效，
+// 不要修改或释放；失败返回 NULL
+const JsonObject* http_get_json(const char* hostname, const char* port, const char* path) {
+	const char* resp;
+
+	// 交还上一次取得的缓存对象
+	http_cached_json_release(g_http_json_held);
+	g_http_json_held = NULL;
+
+	if (g_http_cache.enabled) {
+		resp = http_cached_get(hostname, port, path, &g_http_json_held);
+		if (g_http_json_held != NULL) {
+			return &g_http_json_held->obj;
+		}
+		// 未开启 keep_json，或者响应没有进入缓存（no-store、没有验证器、超过容量），按普通方式解析
+	}
+	else {
+		resp = http_coalesced_get(hostname, port, path, NULL);
+	}
+
+	const char* body = http_response_body(resp);
+	release_json_children(&g_http_json_scratch);
+	if (body == NULL || !parse_json(skip_whitespace(body), &g_http_json_scratch)) {
+		return NULL;
+	}
+	return &g_http_json_scratch;
 }
 
 // 带参数的 GET 请求（自动 URL 编码）
@@ -809,15 +3769,15 @@ const char* http_get_with_params(const char* hostname, const char* port, const c
 	else {
 		strncpy_s(full_path, sizeof(full_path), path, _TRUNCATE);
 	}
-	return http_request(hostname, port, full_path, "GET", NULL, NULL);
+	return http_request(hostname, port, full_path, "GET", NULL, NULL, NULL);
 }
 
 // 简单的 POST 请求
 const char* http_post(const char* hostname, const char* port, const char* path, const char* data) {
-	return http_request(hostname, port, path, "POST", "application/json", data);
+	return http_request(hostname, port, path, "POST", "application/json", data, NULL);
 }
 
 // 表单 POST 请求
 const char* http_post_form(const char* hostname, const char* port, const char* path, const char* form_data) {
-	return http_request(hostname, port, path, "POST", "application/x-www-form-urlencoded", form_data);
+	return http_request(hostname, port, path, "POST", "application/x-www-form-urlencoded", form_data, NULL);
 }
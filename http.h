@@ -1,6 +1,8 @@
 #ifndef HTTP_H
 #define HTTP_H
 
+#include <stddef.h>
+
 #define MAX_JSON_PAIRS 50      // 最大键值对数量
 #define MAX_KEY_LENGTH 100     // 键的最大长度
 #define MAX_VALUE_LENGTH 500   // 值的最大长度
@@ -49,6 +51,8 @@ typedef struct JsonObject {
 
 // 函数声明
 int parse_json(const char* json_str, JsonObject* obj);
+int parse_json_n(const char* buf, size_t len, JsonObject* obj);
+int parse_json_file(const char* path, JsonObject* obj);
 const char* get_json_string(const JsonObject* obj, const char* key);
 double get_json_number(const JsonObject* obj, const char* key);
 int get_json_bool(const JsonObject* obj, const char* key);
@@ -67,4 +71,180 @@ void print_json_object(const JsonObject* obj, int indent);
 void print_json_array(const JsonArray* array, int indent);  // 添加这行
 void clear_json_object(JsonObject* obj);
 
+// 磁带（tape）格式：整个文档存放在连续的 64 位数组中，字符串单独存放。
+// 值用下标表示，根元素的下标为 0；字符串保持原样，不处理转义
+#define JSON_TAPE_NONE ((size_t)-1)
+
+typedef struct JsonTape {
+	unsigned long long* tape;
+	size_t tape_len;
+	size_t tape_capacity;
+	char* strings;
+	size_t strings_len;
+	size_t strings_capacity;
+} JsonTape;
+
+typedef struct JsonTapeIter {
+	const JsonTape* doc;
+	size_t pos;
+	size_t end;
+} JsonTapeIter;
+
+int json_tape_parse(const char* buf, size_t len, JsonTape* doc);
+void json_tape_free(JsonTape* doc);
+JsonValueType json_tape_type(const JsonTape* doc, size_t ref);
+size_t json_tape_next(const JsonTape* doc, size_t ref);
+size_t json_tape_count(const JsonTape* doc, size_t ref);
+const char* json_tape_string(const JsonTape* doc, size_t ref, size_t* len);
+double json_tape_number(const JsonTape* doc, size_t ref);
+int json_tape_bool(const JsonTape* doc, size_t ref);
+size_t json_tape_find(const JsonTape* doc, size_t object_ref, const char* key);
+int json_tape_iter_begin(const JsonTape* doc, size_t ref, JsonTapeIter* iter);
+int json_tape_array_next(JsonTapeIter* iter, size_t* value);
+int json_tape_object_next(JsonTapeIter* iter, const char** key, size_t* key_len, size_t* value);
+
+// 按描述表直接解析到结构体（不构建 JsonObject）
+#define JSON_SCHEMA_MAX_FIELDS 64
+
+typedef enum {
+	JSON_FIELD_STRING,  // char[size]
+	JSON_FIELD_NUMBER,  // double
+	JSON_FIELD_INT,     // int，超出范围的值截断到 INT_MIN / INT_MAX
+	JSON_FIELD_BOOL,    // int
+	JSON_FIELD_OBJECT,  // 嵌套结构体，由 schema 描述
+	JSON_FIELD_ARRAY    // 定长数组，元素类型为 element_type
+} JsonFieldType;
+
+struct JsonSchema;
+
+typedef struct JsonFieldDesc {
+	const char* key;
+	JsonFieldType type;
+	size_t offset;                 // 字段在结构体中的偏移
+	size_t size;                   // 字符串缓冲区大小；数组为单个元素大小
+	struct JsonSchema* schema;     // 嵌套对象（或对象数组元素）的描述表
+	JsonFieldType element_type;    // 数组元素类型
+	size_t count_offset;           // 数组实际元素数量（int）的偏移
+	int max_count;                 // 数组容量
+} JsonFieldDesc;
+
+typedef struct JsonSchema {
+	const JsonFieldDesc* fields;
+	int field_count;
+	// 以下由 json_schema_prepare 填写
+	int prepared;
+	unsigned int seed;
+	unsigned int mask;
+	unsigned char slots[256];
+} JsonSchema;
+
+#define JSON_BIND_STRING(type, member, key) \
+	{ key, JSON_FIELD_STRING, offsetof(type, member), sizeof(((type*)0)->member), NULL, JSON_FIELD_STRING, 0, 0 }
+#define JSON_BIND_NUMBER(type, member, key) \
+	{ key, JSON_FIELD_NUMBER, offsetof(type, member), sizeof(double), NULL, JSON_FIELD_NUMBER, 0, 0 }
+#define JSON_BIND_INT(type, member, key) \
+	{ key, JSON_FIELD_INT, offsetof(type, member), sizeof(int), NULL, JSON_FIELD_INT, 0, 0 }
+#define JSON_BIND_BOOL(type, member, key) \
+	{ key, JSON_FIELD_BOOL, offsetof(type, member), sizeof(int), NULL, JSON_FIELD_BOOL, 0, 0 }
+#define JSON_BIND_OBJECT(type, member, key, sub_schema) \
+	{ key, JSON_FIELD_OBJECT, offsetof(type, member), sizeof(((type*)0)->member), sub_schema, JSON_FIELD_OBJECT, 0, 0 }
+#define JSON_BIND_ARRAY(type, member, key, elem_type, count_member, sub_schema) \
+	{ key, JSON_FIELD_ARRAY, offsetof(type, member), sizeof(((type*)0)->member[0]), sub_schema, elem_type, \
+	  offsetof(type, count_member), (int)(sizeof(((type*)0)->member) / sizeof(((type*)0)->member[0])) }
+#define JSON_SCHEMA(fields) { fields, (int)(sizeof(fields) / sizeof((fields)[0])), 0, 0, 0, { 0 } }
+
+int json_schema_prepare(JsonSchema* schema);
+int json_bind(const char* buf, size_t len, JsonSchema* schema, void* out);
+
+// NDJSON（每行一个 JSON 对象）并行解析
+typedef struct NdjsonOptions {
+	int threads;        // 工作线程数，0 表示 CPU 核心数
+	int unordered;      // 非 0 时不保证按输入顺序回调（占用内存更少）
+	size_t chunk_size;  // 每块字节数，0 使用默认值（64KB）
+} NdjsonOptions;
+
+// record 为 NULL 表示该行解析失败；offset 为该行在输入中的字节偏移；返回 0 停止解析
+typedef int (*NdjsonCallback)(const JsonObject* record, size_t offset, void* user_data);
+long long parse_ndjson(const char* data, size_t len, const NdjsonOptions* options,
+	NdjsonCallback callback, void* user_data);
+
+// UTF-8 / GBK 编码转换
+typedef struct GbkConverter {
+	unsigned char pending[4];  // 跨块边界的不完整字符
+	int pending_len;
+} GbkConverter;
+
+char* utf8_to_gbk(const char* utf8_str);
+char* gbk_to_utf8(const char* gbk_str);
+void print_utf8_as_gbk(const char* utf8_str);
+int utf8_to_gbk_buf(const char* src, size_t src_len, char* dst, size_t dst_size);
+int gbk_to_utf8_buf(const char* src, size_t src_len, char* dst, size_t dst_size);
+void gbk_converter_init(GbkConverter* conv);
+size_t utf8_to_gbk_chunk(GbkConverter* conv, const char* src, size_t src_len,
+	char* dst, size_t dst_size, size_t* src_used);
+size_t gbk_to_utf8_chunk(GbkConverter* conv, const char* src, size_t src_len,
+	char* dst, size_t dst_size, size_t* src_used);
+
+// HTTP 请求函数（返回的响应在当前线程下一次请求前有效）
+const char* http_get(const char* hostname, const char* port, const char* path);
+const char* http_get_with_params(const char* hostname, const char* port, const char* path, const char* params);
+const char* http_post(const char* hostname, const char* port, const char* path, const char* data);
+const char* http_post_form(const char* hostname, const char* port, const char* path, const char* form_data);
+const JsonObject* http_get_json(const char* hostname, const char* port, const char* path);
+int http_status_code(const char* resp);
+
+// 流式请求体：read 向 buf 写入最多 size 字节并返回写入的字节数，0 表示结束，负数表示出错
+typedef long (*HttpBodyReader)(void* user_data, char* buf, size_t size);
+
+typedef struct HttpBodyProvider {
+	HttpBodyReader read;
+	void* user_data;
+	long long length;   // 请求体长度，-1 表示未知（使用 chunked 编码）
+} HttpBodyProvider;
+
+const char* http_send_stream(const char* hostname, const char* port, const char* path,
+	const char* method, const char* content_type, const HttpBodyProvider* body);
+const char* http_post_stream(const char* hostname, const char* port, const char* path,
+	const char* content_type, const HttpBodyProvider* body);
+const char* http_post_file(const char* hostname, const char* port, const char* path,
+	const char* content_type, const char* file_path);
+
+// 分段并行下载（服务器支持 Range 时多连接下载，否则单连接）。
+// 流式上传和分段下载只支持 HTTP/1.1，对 http2_enable_host 登记的主机直接失败
+typedef struct HttpDownloadOptions {
+	int segments;   // 并行段数，0 使用默认值（4）
+	int retries;    // 每段失败后的重试次数
+} HttpDownloadOptions;
+
+long long http_download_file(const char* hostname, const char* port, const char* path,
+	const char* dest_path, const HttpDownloadOptions* options);
+long long http_download_buffer(const char* hostname, const char* port, const char* path,
+	char* buffer, size_t buffer_size, const HttpDownloadOptions* options);
+
+// HTTP/2 明文（h2c prior knowledge）传输：登记的主机自动使用 HTTP/2 连接复用
+int http2_enable_host(const char* hostname, const char* port);
+void http2_reset(void);
+
+// 共享的只读响应缓冲区（引用计数）
+typedef struct HttpBuffer HttpBuffer;
+HttpBuffer* http_get_shared(const char* hostname, const char* port, const char* path);
+HttpBuffer* http_buffer_retain(HttpBuffer* buffer);
+void http_buffer_release(HttpBuffer* buffer);
+const char* http_buffer_data(const HttpBuffer* buffer);
+size_t http_buffer_length(const HttpBuffer* buffer);
+
+// 运行统计
+typedef struct HttpStats {
+	long requests;           // 实际发出的网络请求
+	long coalesced;          // 合并到进行中请求的次数
+	long cache_hits;         // 缓存新鲜命中
+	long cache_revalidated;  // 304 重新验证成功
+} HttpStats;
+void http_get_stats(HttpStats* stats);
+
+// HTTP 响应缓存（默认关闭）
+void http_cache_enable(size_t max_bytes, int keep_json);
+void http_cache_disable(void);
+void http_cache_clear(void);
+
 #endif